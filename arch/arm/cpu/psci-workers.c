@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Run pure computational work items on secondary CPUs brought up with
+ * PSCI CPU_ON. The secondaries share the boot CPU's page tables and
+ * exception vectors, but must not call into drivers, the console, the
+ * allocator or anything else that isn't safe to run concurrently.
+ */
+
+#define pr_fmt(fmt) "psci-workers: " fmt
+
+#include <common.h>
+#include <init.h>
+#include <clock.h>
+#include <malloc.h>
+#include <of.h>
+#include <cpu-workers.h>
+#include <linux/sizes.h>
+#include <asm/cache.h>
+#include <asm/pgtable64.h>
+#include <asm/psci.h>
+#include <asm/system.h>
+
+#include "mmu_64.h"
+
+#define PSCI_WORKER_STACK_SIZE	SZ_16K
+#define PSCI_WORKER_MPIDR_MASK	0xff00ffffffUL
+
+static struct {
+	cpu_work_fn fn;
+	void *data;
+	unsigned int nitems;
+	unsigned int nslots;
+	unsigned long seq;
+	bool park;
+} pool;
+
+static struct psci_worker **workers;
+static unsigned int nworkers;
+static bool probed;
+
+static inline void wfe(void)
+{
+	asm volatile("wfe" : : : "memory");
+}
+
+static inline void sev(void)
+{
+	dsb();
+	asm volatile("sev" : : : "memory");
+}
+
+#define read_sysreg_el(reg, el) ({					\
+	u64 __val;							\
+	switch (el) {							\
+	case 3:								\
+		asm volatile("mrs %0, " #reg "_el3" : "=r" (__val));	\
+		break;							\
+	case 2:								\
+		asm volatile("mrs %0, " #reg "_el2" : "=r" (__val));	\
+		break;							\
+	default:							\
+		asm volatile("mrs %0, " #reg "_el1" : "=r" (__val));	\
+		break;							\
+	}								\
+	__val;								\
+})
+
+static void run_slot(unsigned int slot)
+{
+	unsigned int i;
+
+	for (i = slot; i < pool.nitems; i += pool.nslots)
+		pool.fn(i, pool.data);
+}
+
+void __noreturn psci_worker_main(struct psci_worker *w);
+
+void __noreturn psci_worker_main(struct psci_worker *w)
+{
+	unsigned long seq = 0;
+
+	WRITE_ONCE(w->online, 1);
+	sev();
+
+	for (;;) {
+		while (READ_ONCE(pool.seq) == seq && !READ_ONCE(pool.park))
+			wfe();
+
+		dmb();
+
+		if (READ_ONCE(pool.park))
+			break;
+
+		seq = READ_ONCE(pool.seq);
+
+		/*
+		 * The boot CPU only invalidates its own TLB when it remaps
+		 * memory, so drop whatever we cached from the shared page
+		 * tables before touching the batch's data.
+		 */
+		tlb_invalidate();
+
+		/* late CPUs the boot CPU gave up on don't get any work */
+		if (w->slot < pool.nslots)
+			run_slot(w->slot);
+
+		dmb();
+		WRITE_ONCE(w->done, seq);
+		sev();
+	}
+
+	psci_invoke(ARM_PSCI_0_2_FN_CPU_OFF, 0, 0, 0, NULL);
+
+	/* CPU_OFF doesn't return on success */
+	for (;;)
+		wfe();
+}
+
+static int psci_worker_start(struct psci_worker *w)
+{
+	unsigned int el = current_el();
+	void *stack;
+	u64 start;
+	int ret;
+
+	stack = memalign(16, PSCI_WORKER_STACK_SIZE);
+	if (!stack)
+		return -ENOMEM;
+
+	w->stack_top = (unsigned long)stack + PSCI_WORKER_STACK_SIZE;
+	w->ttbr = get_ttbr(el);
+	w->tcr = read_sysreg_el(tcr, el);
+	w->mair = read_sysreg_el(mair, el);
+	w->sctlr = read_sysreg_el(sctlr, el);
+	w->vbar = read_sysreg_el(vbar, el);
+
+	/*
+	 * The secondary reads its boot parameters and starts using its
+	 * stack with caches disabled, so push both out to memory first.
+	 */
+	v8_flush_dcache_range((unsigned long)w, (unsigned long)(w + 1));
+	v8_flush_dcache_range((unsigned long)stack, w->stack_top);
+
+	ret = psci_invoke(ARM_PSCI_0_2_FN64_CPU_ON, w->mpidr,
+			  (unsigned long)psci_worker_entry, (unsigned long)w,
+			  NULL);
+	if (ret) {
+		free(stack);
+		return ret;
+	}
+
+	start = get_time_ns();
+	while (!READ_ONCE(w->online)) {
+		if (is_timeout(start, 100 * MSECOND))
+			return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+static void psci_workers_probe(void)
+{
+	struct device_node *cpus, *np;
+	unsigned long self = read_mpidr() & PSCI_WORKER_MPIDR_MASK;
+	int version, ret;
+
+	probed = true;
+
+	version = psci_get_version();
+	if (version < ARM_PSCI_VER_0_2)
+		return;
+
+	cpus = of_find_node_by_path("/cpus");
+	if (!cpus)
+		return;
+
+	np = cpus;
+	while ((np = of_find_node_by_type(np, "cpu"))) {
+		struct psci_worker *w;
+		const __be32 *reg;
+		int len;
+
+		if (!of_device_is_available(np))
+			continue;
+
+		reg = of_get_property(np, "reg", &len);
+		if (!reg)
+			continue;
+
+		w = xzalloc(sizeof(*w));
+		w->mpidr = of_read_number(reg, of_n_addr_cells(np));
+		if (w->mpidr == self) {
+			free(w);
+			continue;
+		}
+
+		w->slot = nworkers + 1;
+
+		ret = psci_worker_start(w);
+		if (ret == -ETIMEDOUT) {
+			/* the CPU may still show up, so don't reuse its state */
+			pr_warn("CPU 0x%llx didn't come online\n", w->mpidr);
+			break;
+		}
+		if (ret) {
+			pr_warn("failed to start CPU 0x%llx: %pe\n",
+				w->mpidr, ERR_PTR(ret));
+			free(w);
+			continue;
+		}
+
+		workers = xrealloc(workers, (nworkers + 1) * sizeof(*workers));
+		workers[nworkers++] = w;
+	}
+
+	pr_info("%u secondary CPUs online\n", nworkers);
+}
+
+unsigned int cpu_workers_count(void)
+{
+	if (!probed)
+		psci_workers_probe();
+
+	return nworkers + 1;
+}
+
+/*
+ * The workers drop their TLB before each batch, so they see everything
+ * the boot CPU remapped before calling cpu_workers_run().
+ */
+bool cpu_workers_follow_remap(void)
+{
+	return true;
+}
+
+void cpu_workers_run(cpu_work_fn fn, void *data, unsigned int nitems)
+{
+	unsigned int i;
+
+	if (!probed)
+		psci_workers_probe();
+
+	if (!nworkers || nitems < 2) {
+		for (i = 0; i < nitems; i++)
+			fn(i, data);
+		return;
+	}
+
+	pool.fn = fn;
+	pool.data = data;
+	pool.nitems = nitems;
+	pool.nslots = nworkers + 1;
+
+	dmb();
+	WRITE_ONCE(pool.seq, pool.seq + 1);
+	sev();
+
+	run_slot(0);
+
+	for (i = 0; i < nworkers; i++) {
+		while (READ_ONCE(workers[i]->done) != pool.seq)
+			wfe();
+	}
+
+	dmb();
+}
+
+static void psci_workers_park(void)
+{
+	unsigned int i;
+	ulong state;
+	u64 start;
+
+	if (!nworkers)
+		return;
+
+	WRITE_ONCE(pool.park, true);
+	sev();
+
+	/* The kernel brings the secondaries up on its own, they must be off */
+	for (i = 0; i < nworkers; i++) {
+		struct psci_worker *w = workers[i];
+
+		start = get_time_ns();
+		do {
+			psci_invoke(ARM_PSCI_0_2_FN64_AFFINITY_INFO, w->mpidr,
+				    0, 0, &state);
+			if (state == PSCI_AFFINITY_LEVEL_OFF)
+				break;
+		} while (!is_timeout(start, 100 * MSECOND));
+
+		if (state != PSCI_AFFINITY_LEVEL_OFF)
+			pr_warn("CPU 0x%llx failed to power off\n", w->mpidr);
+	}
+
+	nworkers = 0;
+}
+prearchshutdown_exitcall(psci_workers_park);
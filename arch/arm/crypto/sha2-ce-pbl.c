@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha2-ce-pbl.c - SHA-256 block transform using ARMv8 Crypto Extensions
+ * in the PBL. Padding and finalization are done by the generic code.
+ */
+
+#include <common.h>
+#include <digest.h>
+#include <crypto/sha.h>
+#include <crypto/sha256_base.h>
+#include <crypto/pbl-sha.h>
+#include <linux/linkage.h>
+#include <asm/sysreg.h>
+
+const u32 sha256_ce_offsetof_count = offsetof(struct pbl_sha256_state,
+					      sst.count);
+const u32 sha256_ce_offsetof_finalize = offsetof(struct pbl_sha256_state,
+						 finalize);
+
+asmlinkage int sha2_ce_transform(struct pbl_sha256_state *sst, u8 const *src,
+				 int blocks);
+
+static void sha2_ce_pbl_transform(struct sha256_state *sst, u8 const *src,
+				  int blocks)
+{
+	struct pbl_sha256_state *sctx = container_of(sst,
+					struct pbl_sha256_state, sst);
+
+	while (blocks) {
+		int rem = sha2_ce_transform(sctx, src, blocks);
+
+		src += (blocks - rem) * SHA256_BLOCK_SIZE;
+		blocks = rem;
+	}
+}
+
+static bool sha2_ce_supported(void)
+{
+	/* ID_AA64ISAR0_EL1.SHA2 */
+	return (read_sysreg(id_aa64isar0_el1) >> 12) & 0xf;
+}
+
+int sha256_ce_pbl_update(struct digest *desc, const void *data,
+			 unsigned long len)
+{
+	struct pbl_sha256_state *sctx = digest_ctx(desc);
+
+	if (!sha2_ce_supported())
+		return -ENOSYS;
+
+	sctx->finalize = 0;
+	sha256_base_do_update(desc, data, len, sha2_ce_pbl_transform);
+
+	return 0;
+}
@@ -87,7 +87,7 @@ void *barebox_arm_boot_dtb(void);
  *                                   ↓
  *  ---------------------- arm_mem_barebox_image() ---------------------
  *                                   ↑
- *                                SZ_128K
+ *                       ARM_MEM_EARLY_MALLOC_SIZE
  *                                   ↓
  *  ------------------------ arm_mem_early_malloc ----------------------
  */
@@ -131,7 +131,12 @@ static inline unsigned long arm_mem_ttb(unsigned long endmem)
 	return endmem;
 }
 
+#ifdef CONFIG_IMAGE_COMPRESSION_ZSTD
+/* The zstd decompression context includes a 128KiB block buffer */
+#define ARM_MEM_EARLY_MALLOC_SIZE	SZ_256K
+#else
 #define ARM_MEM_EARLY_MALLOC_SIZE	SZ_128K
+#endif
 
 static inline unsigned long arm_mem_ramoops(unsigned long endmem)
 {
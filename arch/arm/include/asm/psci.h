@@ -117,6 +117,28 @@ static inline int psci_get_version(void)
 
 void psci_cpu_entry(void);
 
+/**
+ * struct psci_worker - state of a secondary CPU brought up as worker
+ *
+ * The first members are consumed by psci_worker_entry() before the MMU
+ * is enabled on the secondary CPU, so they are kept at fixed offsets
+ * exported through asm-offsets.
+ */
+struct psci_worker {
+	u64 stack_top;
+	u64 ttbr;
+	u64 tcr;
+	u64 mair;
+	u64 sctlr;
+	u64 vbar;
+	u64 mpidr;
+	unsigned int slot;
+	unsigned int online;
+	unsigned long done;
+};
+
+void psci_worker_entry(void);
+
 #ifdef CONFIG_ARM_PSCI_DEBUG
 void psci_set_putc(void (*putcf)(void *ctx, int c), void *ctx);
 void psci_putc(char c);
@@ -10,6 +10,7 @@
 
 #include <linux/kbuild.h>
 #include <linux/arm-smccc.h>
+#include <asm/psci.h>
 
 int main(void)
 {
@@ -17,5 +18,11 @@ int main(void)
   DEFINE(ARM_SMCCC_RES_X2_OFFS,		offsetof(struct arm_smccc_res, a2));
   DEFINE(ARM_SMCCC_QUIRK_ID_OFFS,	offsetof(struct arm_smccc_quirk, id));
   DEFINE(ARM_SMCCC_QUIRK_STATE_OFFS,	offsetof(struct arm_smccc_quirk, state));
+  DEFINE(PSCI_WORKER_STACK_OFFS,	offsetof(struct psci_worker, stack_top));
+  DEFINE(PSCI_WORKER_TTBR_OFFS,		offsetof(struct psci_worker, ttbr));
+  DEFINE(PSCI_WORKER_TCR_OFFS,		offsetof(struct psci_worker, tcr));
+  DEFINE(PSCI_WORKER_MAIR_OFFS,		offsetof(struct psci_worker, mair));
+  DEFINE(PSCI_WORKER_SCTLR_OFFS,	offsetof(struct psci_worker, sctlr));
+  DEFINE(PSCI_WORKER_VBAR_OFFS,		offsetof(struct psci_worker, vbar));
   return 0;
 }
@@ -65,6 +65,9 @@ static int do_of_fixup(int argc, char *argv[])
 		}
 	}
 
+	if (did_fixup)
+		of_fixups_changed();
+
 	if (argc && !did_fixup) {
 		printf("none of the specified fixups found\n");
 		return -EINVAL;
@@ -254,8 +254,7 @@ static int do_of_property_set_now(struct device_node *root, const char *path,
 	pp = of_find_property(node, propname, NULL);
 
 	if (pp) {
-		free(pp->value);
-		pp->value_const = NULL;
+		of_property_free_value(pp);
 
 		if (len)
 			pp->value = xmemdup(data, len);
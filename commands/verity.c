@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* verity - create a block device verified against a dm-verity hash tree */
+
+#include <common.h>
+#include <command.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <fs.h>
+#include <driver.h>
+#include <verity.h>
+#include <linux/hex.h>
+
+static int verity_parse_hex(u8 *dst, size_t max, const char *str,
+			    unsigned int *len)
+{
+	size_t n = strlen(str);
+
+	if (n % 2 || n / 2 > max)
+		return -EINVAL;
+
+	*len = n / 2;
+
+	return hex2bin(dst, str, n / 2);
+}
+
+static int do_verity(int argc, char *argv[])
+{
+	struct verity_params params = {
+		.algo = "sha256",
+		.data_block_size = 4096,
+		.hash_block_size = 4096,
+	};
+	struct cdev *data = NULL, *hash = NULL, *cdev;
+	const char *root = NULL, *salt = NULL, *algo = NULL;
+	loff_t hash_offset = 0;
+	int opt, ret;
+
+	while ((opt = getopt(argc, argv, "r:a:s:b:B:n:o:")) > 0) {
+		switch (opt) {
+		case 'r':
+			root = optarg;
+			break;
+		case 'a':
+			algo = optarg;
+			break;
+		case 's':
+			salt = optarg;
+			break;
+		case 'b':
+			params.data_block_size = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			params.hash_block_size = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			params.data_blocks = simple_strtoull(optarg, NULL, 0);
+			break;
+		case 'o':
+			hash_offset = simple_strtoull(optarg, NULL, 0);
+			break;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	if (!root || argc - optind != 3)
+		return COMMAND_ERROR_USAGE;
+
+	data = cdev_open_by_name(devpath_to_name(argv[optind]), O_RDONLY);
+	if (!data) {
+		printf("%s: no such device\n", argv[optind]);
+		return -ENOENT;
+	}
+
+	hash = cdev_open_by_name(devpath_to_name(argv[optind + 1]), O_RDONLY);
+	if (!hash) {
+		printf("%s: no such device\n", argv[optind + 1]);
+		ret = -ENOENT;
+		goto out;
+	}
+
+	/* Without an explicit block count, take the parameters from the superblock */
+	if (!params.data_blocks) {
+		ret = verity_read_superblock(hash, hash_offset, &params);
+		if (ret) {
+			printf("no valid verity superblock on %s: %pe\n",
+			       argv[optind + 1], ERR_PTR(ret));
+			goto out;
+		}
+	} else {
+		params.hash_start = hash_offset;
+	}
+
+	if (algo)
+		strscpy(params.algo, algo, sizeof(params.algo));
+
+	if (salt) {
+		ret = verity_parse_hex(params.salt, sizeof(params.salt), salt,
+				       &params.salt_size);
+		if (ret) {
+			printf("invalid salt\n");
+			goto out;
+		}
+	}
+
+	ret = verity_parse_hex(params.root_digest, sizeof(params.root_digest),
+			       root, &params.root_digest_size);
+	if (ret) {
+		printf("invalid root hash\n");
+		goto out;
+	}
+
+	cdev = verity_create(argv[optind + 2], data, hash, &params);
+	if (IS_ERR(cdev)) {
+		ret = PTR_ERR(cdev);
+		goto out;
+	}
+
+	/* the verity device keeps using the underlying devices */
+	return 0;
+out:
+	if (hash)
+		cdev_close(hash);
+	cdev_close(data);
+
+	return ret;
+}
+
+BAREBOX_CMD_HELP_START(verity)
+BAREBOX_CMD_HELP_TEXT("Create block device NAME, which reads its data from DATADEV and")
+BAREBOX_CMD_HELP_TEXT("verifies every block read against a dm-verity hash tree on HASHDEV")
+BAREBOX_CMD_HELP_TEXT("and a trusted root hash, e.g. taken from a state variable.")
+BAREBOX_CMD_HELP_TEXT("Unless -n is given, the tree parameters are read from the verity")
+BAREBOX_CMD_HELP_TEXT("superblock on HASHDEV.")
+BAREBOX_CMD_HELP_TEXT("")
+BAREBOX_CMD_HELP_TEXT("Options:")
+BAREBOX_CMD_HELP_OPT ("-r HEX",  "root hash (mandatory)")
+BAREBOX_CMD_HELP_OPT ("-o OFFSET",  "offset of superblock or hash tree on HASHDEV")
+BAREBOX_CMD_HELP_OPT ("-n BLOCKS",  "number of data blocks, don't use a superblock")
+BAREBOX_CMD_HELP_OPT ("-a ALGO",  "hash algorithm (default sha256)")
+BAREBOX_CMD_HELP_OPT ("-s HEX",  "salt")
+BAREBOX_CMD_HELP_OPT ("-b SIZE",  "data block size (default 4096)")
+BAREBOX_CMD_HELP_OPT ("-B SIZE",  "hash block size (default 4096)")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(verity)
+	.cmd		= do_verity,
+	BAREBOX_CMD_DESC("create verified block device")
+	BAREBOX_CMD_OPTS("-r HEX [-onabBs] DATADEV HASHDEV NAME")
+	BAREBOX_CMD_GROUP(CMD_GRP_PART)
+	BAREBOX_CMD_HELP(cmd_verity_help)
+BAREBOX_CMD_END
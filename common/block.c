@@ -314,6 +314,10 @@ static ssize_t block_op_write(struct cdev *cdev, const void *buf, size_t count,
 	blkcnt_t blocks;
 	int ret;
 
+	/* refuse before anything ends up in the write buffer */
+	if (!blk->ops->write)
+		return -EROFS;
+
 	/*
 	 * When the offset that is written to is within the first two
 	 * LBAs then the partition table has changed, reparse the partition
@@ -9,13 +9,20 @@
 #include <bootm.h>
 #include <linux/sizes.h>
 
-static unsigned long get_kernel_address(unsigned long os_address,
-					unsigned long text_offset)
+static unsigned long get_kernel_address(struct image_data *data,
+					unsigned long text_offset,
+					unsigned long image_size)
 {
+	unsigned long os_address = data->os_address;
 	resource_size_t start, end;
 	int ret;
 
 	if (!UIMAGE_IS_ADDRESS_VALID(os_address)) {
+		os_address = bootm_fit_kernel_in_place(data, SZ_2M, text_offset,
+						       image_size);
+		if (os_address != UIMAGE_INVALID_ADDRESS)
+			return os_address;
+
 		ret = memory_bank_first_find_space(&start, &end);
 		if (ret)
 			return UIMAGE_INVALID_ADDRESS;
@@ -49,7 +56,7 @@ void *booti_load_image(struct image_data *data, phys_addr_t *oftree)
 	text_offset = le64_to_cpup(kernel_header + 8);
 	image_size = le64_to_cpup(kernel_header + 16);
 
-	kernel = get_kernel_address(data->os_address, text_offset);
+	kernel = get_kernel_address(data, text_offset, image_size);
 
 	pr_debug("Kernel to be loaded to %lx+%lx\n", kernel, image_size);
 
@@ -195,7 +195,12 @@ int bootm_load_os(struct image_data *data, unsigned long load_address)
 				(unsigned long long)load_address + kernel_size - 1);
 			return -ENOMEM;
 		}
-		zero_page_memcpy((void *)load_address, kernel, kernel_size);
+
+		if ((unsigned long)kernel == load_address)
+			pr_debug("using kernel in place at 0x%08lx\n", load_address);
+		else
+			zero_page_memcpy((void *)load_address, kernel, kernel_size);
+
 		return 0;
 	}
 
@@ -222,6 +227,51 @@ int bootm_load_os(struct image_data *data, unsigned long load_address)
 	return 0;
 }
 
+/*
+ * bootm_fit_kernel_in_place() - check if the FIT kernel can be used in place
+ *
+ * @data:	image data context
+ * @align:	alignment the kernel address minus @offset must have
+ * @offset:	offset of the kernel from the aligned address
+ * @size:	memory size the kernel needs, including its BSS
+ *
+ * This checks whether the kernel payload of a FIT image which is used in
+ * place in memory already fulfills the architecture's placement rules and
+ * the memory it needs is available, so that it can be booted without
+ * copying it.
+ *
+ * Return: the kernel address or UIMAGE_INVALID_ADDRESS if it can't be used
+ */
+unsigned long bootm_fit_kernel_in_place(struct image_data *data,
+					unsigned long align,
+					unsigned long offset,
+					unsigned long size)
+{
+	unsigned long kernel = (unsigned long)data->fit_kernel;
+	struct resource *res;
+
+	if (!IS_ENABLED(CONFIG_BOOTM_FITIMAGE_INPLACE) || !data->os_fit)
+		return UIMAGE_INVALID_ADDRESS;
+
+	if (kernel < offset || !IS_ALIGNED(kernel - offset, align))
+		return UIMAGE_INVALID_ADDRESS;
+
+	/*
+	 * initrd and devicetree are placed behind the kernel. They must not
+	 * overwrite parts of the FIT image which are still to be loaded.
+	 */
+	if (kernel + size < (unsigned long)data->os_fit->fit + data->os_fit->size)
+		return UIMAGE_INVALID_ADDRESS;
+
+	res = request_sdram_region("kernel", kernel, size);
+	if (!res)
+		return UIMAGE_INVALID_ADDRESS;
+
+	release_sdram_region(res);
+
+	return kernel;
+}
+
 static bool fitconfig_has_ramdisk(struct image_data *data)
 {
 	if (!IS_ENABLED(CONFIG_FITIMAGE) || !data->os_fit)
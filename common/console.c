@@ -21,7 +21,9 @@
 #include <ratp_bb.h>
 #include <magicvar.h>
 #include <globalvar.h>
+#include <poller.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 #include <linux/stringify.h>
 #include <debug_ll.h>
 
@@ -46,6 +48,106 @@ static struct kfifo __console_output_fifo;
 static struct kfifo *console_input_fifo = &__console_input_fifo;
 static struct kfifo *console_output_fifo = &__console_output_fifo;
 
+#ifdef CONFIG_CONSOLE_TX_BUFFER
+#define CONSOLE_TX_BUFFER_SIZE	roundup_pow_of_two(CONFIG_CONSOLE_TX_BUFFER_SIZE)
+#else
+#define CONSOLE_TX_BUFFER_SIZE	0
+#endif
+
+/*
+ * Write out the characters buffered for @cdev. Unless @sync is true, stop as
+ * soon as the console would have to wait for the transmitter.
+ */
+static void console_tx_drain(struct console_device *cdev, bool sync)
+{
+	unsigned char c;
+
+	if (!cdev->tx_fifo)
+		return;
+
+	while (kfifo_len(cdev->tx_fifo)) {
+		if (!sync && !cdev->tx_ready(cdev))
+			break;
+
+		kfifo_getc(cdev->tx_fifo, &c);
+		cdev->putc(cdev, c);
+	}
+}
+
+#ifdef CONFIG_CONSOLE_TX_BUFFER
+/**
+ * console_tx_flush - write out all output buffered for a console
+ * @cdev: the console
+ *
+ * Must be called before writing to @cdev with its putc() directly, so that
+ * the raw data isn't overtaken by previously printed text.
+ */
+void console_tx_flush(struct console_device *cdev)
+{
+	console_tx_drain(cdev, true);
+}
+EXPORT_SYMBOL(console_tx_flush);
+#endif
+
+static void console_tx_drain_all(void)
+{
+	struct console_device *cdev;
+
+	for_each_console(cdev)
+		console_tx_drain(cdev, true);
+}
+
+static void console_tx_putc(struct console_device *cdev, char c)
+{
+	unsigned char old;
+
+	if (!cdev->tx_fifo) {
+		cdev->putc(cdev, c);
+		return;
+	}
+
+	/* Buffer full, make room by waiting for the oldest character to go out */
+	if (kfifo_len(cdev->tx_fifo) == cdev->tx_fifo->size) {
+		kfifo_getc(cdev->tx_fifo, &old);
+		cdev->putc(cdev, old);
+	}
+
+	kfifo_putc(cdev->tx_fifo, c);
+}
+
+static int console_tx_puts(struct console_device *cdev, const char *s,
+			   size_t nbytes)
+{
+	size_t i;
+
+	for (i = 0; i < nbytes; i++) {
+		if (*s == '\n') {
+			console_tx_putc(cdev, '\r');
+			if (IS_ENABLED(CONFIG_CONSOLE_FLUSH_LINE_BREAK) && cdev->flush) {
+				console_tx_drain(cdev, true);
+				cdev->flush(cdev);
+			}
+		}
+
+		console_tx_putc(cdev, *s);
+		s++;
+	}
+
+	return i;
+}
+
+static void console_tx_poll(struct poller_struct *poller)
+{
+	struct console_device *cdev;
+
+	for_each_console(cdev)
+		console_tx_drain(cdev, false);
+}
+
+static struct poller_struct console_tx_poller = {
+	.func = console_tx_poll,
+};
+
 int console_open(struct console_device *cdev)
 {
 	int ret;
@@ -88,8 +190,11 @@ int console_set_active(struct console_device *cdev, unsigned flag)
 	if (!cdev->putc)
 		flag &= ~(CONSOLE_STDOUT | CONSOLE_STDERR);
 
-	if (!flag && cdev->f_active && cdev->flush)
-		cdev->flush(cdev);
+	if (!flag && cdev->f_active) {
+		console_tx_drain(cdev, true);
+		if (cdev->flush)
+			cdev->flush(cdev);
+	}
 
 	if (flag == cdev->f_active)
 		return 0;
@@ -178,6 +283,8 @@ int console_set_baudrate(struct console_device *cdev, unsigned baudrate)
 	if (cdev->f_active) {
 		printf("## Switch baudrate on console %s to %d bps and press ENTER ...\n",
 			dev_name(&cdev->class_dev), baudrate);
+		/* send everything printed so far at the old baudrate */
+		console_tx_drain(cdev, true);
 		mdelay(50);
 	}
 
@@ -385,9 +492,18 @@ int console_register(struct console_device *newcdev)
 
 	newcdev->baudrate = baudrate;
 
-	if (newcdev->putc && !newcdev->puts)
+	if (newcdev->putc && !newcdev->puts) {
 		newcdev->puts = __console_puts;
 
+		if (IS_ENABLED(CONFIG_CONSOLE_TX_BUFFER) && newcdev->tx_ready) {
+			newcdev->tx_fifo = kfifo_alloc(CONSOLE_TX_BUFFER_SIZE);
+			if (newcdev->tx_fifo)
+				newcdev->puts = console_tx_puts;
+			if (!console_tx_poller.registered)
+				poller_register(&console_tx_poller, "console-tx");
+		}
+	}
+
 	dev_add_param_string(dev, "active", console_active_set, console_active_get,
 			     &newcdev->active_string, newcdev);
 
@@ -444,6 +560,10 @@ int console_unregister(struct console_device *cdev)
 
 	devfs_remove(&cdev->devfs);
 
+	console_tx_drain(cdev, true);
+	if (cdev->tx_fifo)
+		kfifo_free(cdev->tx_fifo);
+
 	list_del(&cdev->list);
 	if (list_empty(&console_list))
 		initialized = CONSOLE_UNINITIALIZED;
@@ -530,6 +650,9 @@ int getchar(void)
 	unsigned char ch;
 	uint64_t start;
 
+	/* Make sure everything printed so far is visible before waiting for input */
+	console_tx_drain_all();
+
 	/*
 	 * For 100us we read the characters from the serial driver
 	 * into a kfifo. This helps us not to lose characters
@@ -588,8 +711,8 @@ void console_putc(unsigned int ch, char c)
 		for_each_console(cdev) {
 			if (cdev->f_active & ch) {
 				if (c == '\n')
-					cdev->putc(cdev, '\r');
-				cdev->putc(cdev, c);
+					console_tx_putc(cdev, '\r');
+				console_tx_putc(cdev, c);
 			}
 		}
 		return;
@@ -634,6 +757,7 @@ void console_flush(void)
 	struct console_device *cdev;
 
 	for_each_console(cdev) {
+		console_tx_drain(cdev, true);
 		if (cdev->flush)
 			cdev->flush(cdev);
 	}
@@ -14,15 +14,11 @@
 #include <environment.h>
 #include <globalvar.h>
 #include <magicvar.h>
-#include <memory.h>
 #include <of.h>
 #include <password.h>
 #include <clock.h>
-#include <malloc.h>
 #include <linux/pstore.h>
 #include <linux/math64.h>
-#include <linux/sizes.h>
-#include <linux/overflow.h>
 
 #ifndef CONFIG_CONSOLE_NONE
 
@@ -37,17 +33,124 @@ static const char *colored_log_level[] = {
 
 int barebox_loglevel = CONFIG_DEFAULT_LOGLEVEL;
 
-LIST_HEAD(barebox_logbuf);
-static int barebox_logbuf_num_messages;
+#ifdef CONFIG_LOGBUF
+#define LOGBUF_SIZE	ALIGN_DOWN(CONFIG_LOGBUF_SIZE, 8)
+#else
+#define LOGBUF_SIZE	0
+#endif
+
+/*
+ * The log is kept in a ring buffer of variable sized records which are 8 byte
+ * aligned and never wrap. If a record doesn't fit into the space left at the
+ * end of the buffer, that space is marked unused with a zero length record
+ * (if the header fits) and the record is stored at the start of the buffer.
+ */
+static char barebox_logbuf[LOGBUF_SIZE] __aligned(8);
+static size_t barebox_logbuf_first;	/* offset of the oldest record */
+static size_t barebox_logbuf_next;	/* offset the next record is stored at */
+static unsigned int barebox_logbuf_num_messages;
 static int barebox_log_max_messages;
 
-static void log_del(struct log_entry *log)
+static struct log_entry *log_at(size_t ofs)
+{
+	return (struct log_entry *)(barebox_logbuf + ofs);
+}
+
+/* Returns the offset of the record following the one at @ofs */
+static size_t log_next_ofs(size_t ofs)
 {
-	list_del(&log->list);
-	free(log);
+	ofs += log_at(ofs)->len;
+	if (ofs == barebox_logbuf_next)
+		return ofs;
+
+	if (LOGBUF_SIZE - ofs < sizeof(struct log_entry) || !log_at(ofs)->len)
+		return 0;
+
+	return ofs;
+}
+
+static bool log_fits(size_t len)
+{
+	if (barebox_logbuf_next > barebox_logbuf_first)
+		return LOGBUF_SIZE - barebox_logbuf_next >= len ||
+		       barebox_logbuf_first >= len;
+
+	return barebox_logbuf_first - barebox_logbuf_next >= len;
+}
+
+static void log_del_first(void)
+{
+	barebox_logbuf_first = log_next_ofs(barebox_logbuf_first);
 	barebox_logbuf_num_messages--;
 }
 
+static void log_add(int level, const char *str)
+{
+	struct log_entry *log;
+	size_t msglen, len;
+
+	msglen = strlen(str);
+	len = ALIGN(sizeof(*log) + msglen + 1, 8);
+	if (len > LOGBUF_SIZE) {
+		msglen = LOGBUF_SIZE - sizeof(*log) - 1;
+		len = LOGBUF_SIZE;
+	}
+
+	/* Overwrite the oldest messages until the new one fits */
+	while (barebox_logbuf_num_messages && !log_fits(len))
+		log_del_first();
+
+	if (!barebox_logbuf_num_messages)
+		barebox_logbuf_first = barebox_logbuf_next = 0;
+
+	if (LOGBUF_SIZE - barebox_logbuf_next < len) {
+		if (LOGBUF_SIZE - barebox_logbuf_next >= sizeof(*log))
+			log_at(barebox_logbuf_next)->len = 0;
+		barebox_logbuf_next = 0;
+	}
+
+	log = log_at(barebox_logbuf_next);
+	log->timestamp = get_time_ns();
+	log->len = len;
+	log->msg_len = msglen;
+	log->level = level;
+	memcpy(log->msg, str, msglen);
+	log->msg[msglen] = 0;
+
+	barebox_logbuf_next += len;
+	barebox_logbuf_num_messages++;
+}
+
+/**
+ * log_first - get the oldest message in the log buffer
+ *
+ * Return: the oldest message or NULL if the log buffer is empty
+ */
+struct log_entry *log_first(void)
+{
+	if (!barebox_logbuf_num_messages)
+		return NULL;
+
+	return log_at(barebox_logbuf_first);
+}
+
+/**
+ * log_next - get the message following a message in the log buffer
+ *
+ * @log:	The current message
+ *
+ * Return: the next message or NULL if @log is the newest message
+ */
+struct log_entry *log_next(const struct log_entry *log)
+{
+	size_t ofs = log_next_ofs((const char *)log - barebox_logbuf);
+
+	if (ofs == barebox_logbuf_next)
+		return NULL;
+
+	return log_at(ofs);
+}
+
 /**
  * log_clean - delete log messages from buffer
  *
@@ -59,16 +162,8 @@ static void log_del(struct log_entry *log)
  */
 void log_clean(unsigned int limit)
 {
-	struct log_entry *log, *tmp;
-
-	if (list_empty(&barebox_logbuf))
-		return;
-
-	list_for_each_entry_safe(log, tmp, &barebox_logbuf, list) {
-		if (barebox_logbuf_num_messages <= limit)
-			break;
-		log_del(log);
-	}
+	while (barebox_logbuf_num_messages > limit)
+		log_del_first();
 }
 
 static void print_colored_log_level(unsigned int ch, const int level)
@@ -85,31 +180,15 @@ static void print_colored_log_level(unsigned int ch, const int level)
 
 static void pr_puts(int level, const char *str)
 {
-	struct log_entry *log;
-
-	if (IS_ENABLED(CONFIG_LOGBUF) && mem_malloc_is_initialized()) {
+	if (IS_ENABLED(CONFIG_LOGBUF)) {
 		if (barebox_log_max_messages > 0)
 			log_clean(barebox_log_max_messages - 1);
 
-		if (barebox_log_max_messages >= 0) {
-			int msglen;
-
-			msglen = strlen(str);
-			log = malloc(struct_size(log, msg, msglen + 1));
-			if (!log)
-				goto nolog;
-
-			memcpy(log->msg, str, msglen + 1);
-
-			log->timestamp = get_time_ns();
-			log->level = level;
-			list_add_tail(&log->list, &barebox_logbuf);
-			barebox_logbuf_num_messages++;
-		}
+		if (barebox_log_max_messages >= 0)
+			log_add(level, str);
 	}
 
 	pstore_log(str);
-nolog:
 
 	if (level > barebox_loglevel)
 		return;
@@ -177,12 +256,9 @@ bool console_allow_color(void)
 
 static int console_common_init(void)
 {
-	if (IS_ENABLED(CONFIG_LOGBUF)) {
-		barebox_log_max_messages
-			= clamp(mem_malloc_size() / SZ_32K, 1000UL, 100000UL);
+	if (IS_ENABLED(CONFIG_LOGBUF))
 		globalvar_add_simple_int("log_max_messages",
 				&barebox_log_max_messages, "%d");
-	}
 
 	globalvar_add_simple_bool("allow_color", &__console_allow_color);
 
@@ -199,7 +275,7 @@ int log_writefile(const char *filepath)
 	if (fd < 0)
 		return -errno;
 
-	list_for_each_entry(log, &barebox_logbuf, list) {
+	for_each_log_entry(log) {
 		ret = dputs(fd, log->msg);
 		if (ret < 0)
 			break;
@@ -215,7 +291,7 @@ int log_print(unsigned flags, unsigned levels)
 	struct log_entry *log;
 	unsigned long last = 0;
 
-	list_for_each_entry(log, &barebox_logbuf, list) {
+	for_each_log_entry(log) {
 		uint64_t time_ns = log->timestamp;
 		unsigned long time;
 
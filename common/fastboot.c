@@ -418,6 +418,8 @@ void fastboot_abort(struct fastboot *fb)
 
 static void cb_download(struct fastboot *fb, const char *cmd)
 {
+	int ret;
+
 	fb->download_size = simple_strtoul(cmd, NULL, 16);
 	fb->download_bytes = 0;
 
@@ -437,11 +439,22 @@ static void cb_download(struct fastboot *fb, const char *cmd)
 			return;
 	}
 
-	if (!fb->download_size)
+	if (!fb->download_size) {
 		fastboot_tx_print(fb, FASTBOOT_MSG_FAIL,
 					  "data invalid size");
-	else
-		fb->start_download(fb);
+		return;
+	}
+
+	/*
+	 * Allocate the whole file up front, so that it ends up contiguous
+	 * on ramfs and can be memmap()ed instead of being copied again.
+	 */
+	ret = ftruncate(fb->download_fd, fb->download_size);
+	if (ret)
+		pr_debug("cannot preallocate %s: %pe\n", fb->tempname,
+			 ERR_PTR(ret));
+
+	fb->start_download(fb);
 }
 
 void fastboot_start_download_generic(struct fastboot *fb)
@@ -23,6 +23,8 @@
 #include <crypto/public_key.h>
 #include <uncompress.h>
 #include <image-fit.h>
+#include <fcntl.h>
+#include <zero_page.h>
 
 #define FDT_MAX_DEPTH 32
 #define FDT_MAX_PATH_LEN 200
@@ -63,6 +65,79 @@ static int of_read_string_list(struct device_node *np, const char *name, struct
 	return prop ? 0 : -EINVAL;
 }
 
+static bool fit_is_verified(struct fit_handle *handle, struct device_node *np)
+{
+	return string_list_contains(&handle->verified, np->full_name);
+}
+
+static void fit_set_verified(struct fit_handle *handle, struct device_node *np)
+{
+	string_list_add(&handle->verified, np->full_name);
+}
+
+/*
+ * When booting fails, bootm or bootchooser may try another configuration
+ * of the same FIT image, often referencing the very same kernel. The buffer
+ * of the last closed FIT image is kept together with its verification results
+ * and reused if the next FIT image read is byte-identical, so that images
+ * already verified need not be hashed again.
+ */
+static struct {
+	void *fit_alloc;
+	size_t size;
+	struct string_list verified;
+} fit_verify_cache = {
+	.verified = { .list = LIST_HEAD_INIT(fit_verify_cache.verified.list) },
+};
+
+static void fit_verify_cache_drop(void)
+{
+	free(fit_verify_cache.fit_alloc);
+	fit_verify_cache.fit_alloc = NULL;
+	string_list_free(&fit_verify_cache.verified);
+	string_list_init(&fit_verify_cache.verified);
+}
+
+static void fit_verify_cache_store(struct fit_handle *handle)
+{
+	if (!IS_ENABLED(CONFIG_BOOTM_FITIMAGE_VERIFY_CACHE) ||
+	    !handle->fit_alloc || !string_list_count(&handle->verified))
+		return;
+
+	fit_verify_cache_drop();
+
+	fit_verify_cache.fit_alloc = handle->fit_alloc;
+	fit_verify_cache.size = handle->size;
+	list_splice_init(&handle->verified.list,
+			 &fit_verify_cache.verified.list);
+
+	handle->fit_alloc = NULL;
+}
+
+static void fit_verify_cache_lookup(struct fit_handle *handle)
+{
+	if (!fit_verify_cache.fit_alloc || !handle->fit_alloc)
+		return;
+
+	/*
+	 * Comparing is much cheaper than hashing and guarantees we operate on
+	 * the very bytes that have been verified before.
+	 */
+	if (fit_verify_cache.size != handle->size ||
+	    memcmp(fit_verify_cache.fit_alloc, handle->fit_alloc, handle->size)) {
+		fit_verify_cache_drop();
+		return;
+	}
+
+	pr_debug("reusing verification results of identical FIT image\n");
+
+	free(handle->fit_alloc);
+	handle->fit_alloc = fit_verify_cache.fit_alloc;
+	fit_verify_cache.fit_alloc = NULL;
+	list_splice_init(&fit_verify_cache.verified.list,
+			 &handle->verified.list);
+}
+
 static int fit_digest(const void *fit, struct digest *digest,
 		      struct string_list *inc_nodes, struct string_list *exc_props,
 		      uint32_t hashed_strings_start, uint32_t hashed_strings_size)
@@ -258,7 +333,8 @@ static int fit_check_signature(struct device_node *sig_node,
 {
 	const struct public_key *key;
 	const char *key_name = NULL;
-	int sig_len;
+	const void *fp;
+	int sig_len, fp_len;
 	const char *sig_value;
 	int ret;
 
@@ -268,6 +344,28 @@ static int fit_check_signature(struct device_node *sig_node,
 		return -EINVAL;
 	}
 
+	/*
+	 * A key fingerprint identifies the key unambiguously, so no other
+	 * keys need to be tried when it is present.
+	 */
+	fp = of_get_property(sig_node, "key-fingerprint", &fp_len);
+	if (fp) {
+		key = public_key_get_by_fingerprint(fp, fp_len);
+		if (!key) {
+			pr_err("no key matching key-fingerprint of %pOF\n",
+			       sig_node);
+			return -ENOKEY;
+		}
+
+		ret = public_key_verify(key, sig_value, sig_len, hash, algo);
+		if (!ret)
+			goto ok;
+
+		pr_err("image signature BAD\n");
+
+		return -EBADMSG;
+	}
+
 	of_property_read_string(sig_node, "key-name-hint", &key_name);
 	if (key_name) {
 		key = public_key_get(key_name);
@@ -360,6 +458,52 @@ static int fit_verify_signature(struct device_node *sig_node, const void *fit)
 	return ret;
 }
 
+static int fit_verify_hash_value(struct digest *d, const void *value,
+				 const void *data, int data_len)
+{
+	digest_init(d);
+	digest_update(d, data, data_len);
+
+	return digest_verify(d, value) ? -EBADMSG : 0;
+}
+
+/*
+ * Chunked hashes split the image into chunk-size sized chunks, hashed
+ * independently of each other. The chunk-hashes property holds all their
+ * digests back to back and value is the digest over chunk-hashes, so only
+ * the latter has to be hashed sequentially. The chunks themselves can then
+ * be verified in parallel.
+ */
+static int fit_verify_hash_chunks(struct device_node *hash, struct digest *d,
+				  const char *algo, const void *value,
+				  const void *data, int data_len)
+{
+	const void *chunk_hashes;
+	size_t nchunks;
+	u32 chunk_size;
+	int len;
+
+	if (of_property_read_u32(hash, "chunk-size", &chunk_size) ||
+	    !chunk_size) {
+		pr_err("%pOF: invalid \"chunk-size\" property\n", hash);
+		return -EINVAL;
+	}
+
+	nchunks = DIV_ROUND_UP(data_len, chunk_size);
+
+	chunk_hashes = of_get_property(hash, "chunk-hashes", &len);
+	if (!chunk_hashes || len != nchunks * digest_length(d)) {
+		pr_err("%pOF: invalid \"chunk-hashes\" property\n", hash);
+		return -EINVAL;
+	}
+
+	if (fit_verify_hash_value(d, value, chunk_hashes, len))
+		return -EBADMSG;
+
+	return digest_chunks_verify(algo, data, data_len, chunk_size,
+				    chunk_hashes, 0, nchunks);
+}
+
 static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
 			   const void *data, int data_len)
 {
@@ -388,6 +532,11 @@ static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
 		return ret;
 	}
 
+	if (fit_is_verified(handle, hash)) {
+		pr_info("%pOF: hash OK (cached)\n", hash);
+		return 0;
+	}
+
 	value_read = of_get_property(hash, "value", &hash_len);
 	if (!value_read) {
 		pr_err("%pOF: \"value\" property not found\n", hash);
@@ -411,15 +560,17 @@ static int fit_verify_hash(struct fit_handle *handle, struct device_node *image,
 		goto err_digest_free;
 	}
 
-	digest_init(d);
-	digest_update(d, data, data_len);
+	if (of_property_present(hash, "chunk-size"))
+		ret = fit_verify_hash_chunks(hash, d, algo, value_read,
+					     data, data_len);
+	else
+		ret = fit_verify_hash_value(d, value_read, data, data_len);
 
-	if (digest_verify(d, value_read)) {
+	if (ret) {
 		pr_info("%pOF: hash BAD\n", hash);
-		ret =  -EBADMSG;
 	} else {
 		pr_info("%pOF: hash OK\n", hash);
-		ret = 0;
+		fit_set_verified(handle, hash);
 	}
 
 err_digest_free:
@@ -459,6 +610,11 @@ static int fit_image_verify_signature(struct fit_handle *handle,
 		return ret;
 	}
 
+	if (fit_is_verified(handle, sig_node)) {
+		pr_info("%pOF: signature OK (cached)\n", sig_node);
+		return 0;
+	}
+
 	digest = fit_alloc_digest(sig_node, &algo);
 	if (IS_ERR(digest))
 		return PTR_ERR(digest);
@@ -468,6 +624,8 @@ static int fit_image_verify_signature(struct fit_handle *handle,
 	digest_final(digest, hash);
 
 	ret = fit_check_signature(sig_node, algo, hash);
+	if (!ret)
+		fit_set_verified(handle, sig_node);
 
 	free(hash);
 
@@ -717,12 +875,20 @@ static int fit_config_verify_signature(struct fit_handle *handle, struct device_
 		if (!of_node_has_prefix(sig_node, "signature"))
 			continue;
 
+		if (fit_is_verified(handle, sig_node)) {
+			pr_info("%pOF: signature OK (cached)\n", sig_node);
+			ret = 0;
+			continue;
+		}
+
 		if (handle->verbose)
 			of_print_nodes(sig_node, 0, ~0);
 
 		ret = fit_verify_signature(sig_node, handle->fit);
 		if (ret < 0)
 			return ret;
+
+		fit_set_verified(handle, sig_node);
 	}
 
 	if (ret < 0) {
@@ -919,6 +1085,7 @@ struct fit_handle *fit_open_buf(const void *buf, size_t size, bool verbose,
 	handle->fit = buf;
 	handle->size = size;
 	handle->verify = verify;
+	string_list_init(&handle->verified);
 
 	ret = fit_do_open(handle);
 	if (ret) {
@@ -929,6 +1096,38 @@ struct fit_handle *fit_open_buf(const void *buf, size_t size, bool verbose,
 	return handle;
 }
 
+/*
+ * Get a FIT image that is memory mapped, e.g. on a memory device, without
+ * copying it. Images the kernel is found in place in can be booted without
+ * copying the kernel.
+ */
+static const void *fit_memmap(const char *filename, size_t *size,
+			      loff_t max_size)
+{
+	const void *fit = NULL;
+	struct stat s;
+	void *map;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &s) || s.st_size == FILE_SIZE_STREAM)
+		goto out;
+
+	map = memmap(fd, PROT_READ);
+	if (map == MAP_FAILED || zero_page_contains((ulong)map))
+		goto out;
+
+	*size = min_t(loff_t, s.st_size, max_size);
+	fit = map;
+out:
+	close(fd);
+
+	return fit;
+}
+
 /**
  * fit_open - open a FIT image
  * @filename:	The filename of the FIT image
@@ -951,15 +1150,23 @@ struct fit_handle *fit_open(const char *filename, bool verbose,
 
 	handle->verbose = verbose;
 	handle->verify = verify;
+	string_list_init(&handle->verified);
 
-	ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
-			  max_size);
-	if (ret && ret != -EFBIG) {
-		pr_err("unable to read %s: %pe\n", filename, ERR_PTR(ret));
-		return ERR_PTR(ret);
-	}
+	if (IS_ENABLED(CONFIG_BOOTM_FITIMAGE_INPLACE))
+		handle->fit = fit_memmap(filename, &handle->size, max_size);
 
-	handle->fit = handle->fit_alloc;
+	if (!handle->fit) {
+		ret = read_file_2(filename, &handle->size, &handle->fit_alloc,
+				  max_size);
+		if (ret && ret != -EFBIG) {
+			pr_err("unable to read %s: %pe\n", filename, ERR_PTR(ret));
+			return ERR_PTR(ret);
+		}
+
+		fit_verify_cache_lookup(handle);
+
+		handle->fit = handle->fit_alloc;
+	}
 
 	ret = fit_do_open(handle);
 	if (ret) {
@@ -975,6 +1182,9 @@ void fit_close(struct fit_handle *handle)
 	if (handle->root)
 		of_delete_node(handle->root);
 
+	fit_verify_cache_store(handle);
+	string_list_free(&handle->verified);
+
 	free(handle->fit_alloc);
 	free(handle);
 }
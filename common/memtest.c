@@ -17,6 +17,9 @@
 #include <memtest.h>
 #include <malloc.h>
 #include <mmu.h>
+#include <clock.h>
+#include <cpu-workers.h>
+#include <linux/math64.h>
 
 static int alloc_memtest_region(struct list_head *list,
 		resource_size_t start, resource_size_t size)
@@ -342,12 +345,13 @@ int mem_test_bus_integrity(resource_size_t _start,
 	return 0;
 }
 
+/* Words processed by a single work item */
+#define MEMTEST_BLOCK_WORDS	SZ_4K
+/* Blocks per CPU processed between two ctrlc()/progress bar updates */
+#define MEMTEST_ROUND_BLOCKS	16
+
 static int update_progress(resource_size_t offset, unsigned flags)
 {
-	/* Only check every 4k to reduce overhead */
-	if (offset & (SZ_4K - 1))
-		return 0;
-
 	if (ctrlc())
 		return -EINTR;
 
@@ -357,11 +361,150 @@ static int update_progress(resource_size_t offset, unsigned flags)
 	return 0;
 }
 
+/*
+ * The per-block helpers below only access the memory under test through
+ * a volatile pointer, while the loop state is kept in registers. Each of
+ * them returns the index of the first mismatching word or @num when the
+ * whole block passed.
+ */
+static resource_size_t mem_test_fill_block(volatile resource_size_t *p,
+					   resource_size_t pattern,
+					   resource_size_t num)
+{
+	resource_size_t i;
+
+	for (i = 0; i + 4 <= num; i += 4) {
+		p[i + 0] = pattern + i + 0;
+		p[i + 1] = pattern + i + 1;
+		p[i + 2] = pattern + i + 2;
+		p[i + 3] = pattern + i + 3;
+	}
+
+	for (; i < num; i++)
+		p[i] = pattern + i;
+
+	return num;
+}
+
+static resource_size_t mem_test_invert_block(volatile resource_size_t *p,
+					     resource_size_t pattern,
+					     resource_size_t num)
+{
+	resource_size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (p[i] != pattern + i)
+			break;
+		p[i] = ~(pattern + i);
+	}
+
+	return i;
+}
+
+static resource_size_t mem_test_clear_block(volatile resource_size_t *p,
+					    resource_size_t pattern,
+					    resource_size_t num)
+{
+	resource_size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (p[i] != ~(pattern + i))
+			break;
+		p[i] = 0;
+	}
+
+	return i;
+}
+
+typedef resource_size_t (*mem_test_pass_fn)(volatile resource_size_t *,
+					    resource_size_t, resource_size_t);
+
+/* A range of blocks, processed in parallel on all available CPUs */
+struct mem_test_round {
+	mem_test_pass_fn pass;
+	volatile resource_size_t *start;
+	resource_size_t offset;
+	resource_size_t num_words;
+	resource_size_t *result;
+	bool serial;
+};
+
+/* Runs on any CPU, so must neither allocate nor print */
+static void mem_test_block_work(unsigned int item, void *data)
+{
+	struct mem_test_round *round = data;
+	resource_size_t offset = round->offset +
+				 (resource_size_t)item * MEMTEST_BLOCK_WORDS;
+	resource_size_t num = min_t(resource_size_t,
+				    round->offset + round->num_words - offset,
+				    MEMTEST_BLOCK_WORDS);
+
+	round->result[item] = round->pass(&round->start[offset], offset + 1, num);
+}
+
+/*
+ * Returns the offset of the first mismatching word in the round or
+ * the offset following the round when all its blocks passed.
+ */
+static resource_size_t mem_test_run_round(struct mem_test_round *round)
+{
+	unsigned int nblocks, i;
+	resource_size_t offset, num;
+
+	nblocks = DIV_ROUND_UP((unsigned long)round->num_words,
+			       MEMTEST_BLOCK_WORDS);
+
+	if (round->serial) {
+		for (i = 0; i < nblocks; i++)
+			mem_test_block_work(i, round);
+	} else {
+		cpu_workers_run(mem_test_block_work, round, nblocks);
+	}
+
+	for (i = 0; i < nblocks; i++) {
+		offset = round->offset + (resource_size_t)i * MEMTEST_BLOCK_WORDS;
+		num = min_t(resource_size_t,
+			    round->offset + round->num_words - offset,
+			    MEMTEST_BLOCK_WORDS);
+
+		if (round->result[i] != num)
+			return offset + round->result[i];
+	}
+
+	return round->offset + round->num_words;
+}
+
+static void mem_test_report_throughput(resource_size_t tested,
+				       resource_size_t requested,
+				       u64 ns)
+{
+	/* one write and two read/write passes over each word */
+	u64 transferred = 5ULL * tested;
+	u64 us = max_t(u64, div_u64(ns, 1000), 1);
+
+	printf("Tested %llu of %llu KiB in %llu ms, %llu MiB/s\n",
+	       (unsigned long long)tested / SZ_1K,
+	       (unsigned long long)requested / SZ_1K,
+	       div_u64(us, 1000),
+	       div64_u64(transferred / SZ_1K * 1000000, us) / SZ_1K);
+}
+
 int mem_test_moving_inversions(resource_size_t _start, resource_size_t _end,
 			       unsigned flags)
 {
-	volatile resource_size_t *start, num_words, offset, temp, anti_pattern;
-	int ret;
+	static const mem_test_pass_fn pass[] = {
+		mem_test_fill_block,
+		mem_test_invert_block,
+		mem_test_clear_block,
+	};
+	struct mem_test_round round;
+	volatile resource_size_t *start;
+	resource_size_t num_words, offset, failed, requested, round_words;
+	unsigned int ncpus;
+	u64 time;
+	int i, ret = 0;
+
+	requested = _end - _start + 1;
 
 	_start = ALIGN(_start, sizeof(resource_size_t));
 	_end = ALIGN_DOWN(_end, sizeof(resource_size_t)) - 1;
@@ -388,60 +531,67 @@ int mem_test_moving_inversions(resource_size_t _start, resource_size_t _end,
 	 *		as a zero and a one. The base address
 	 *		and the size of the region are
 	 *		selected by the caller.
+	 *
+	 * The first pass fills memory with offset + 1, the second
+	 * checks each location and inverts it and the third checks
+	 * for the inverted pattern and zeroes the location again.
+	 *
+	 * Each pass is split into blocks which are spread over all CPUs
+	 * barebox has brought up. A pass is completed on all CPUs before
+	 * the next one starts. The region has usually just been remapped
+	 * cached or uncached, so if the other CPUs may still use the old
+	 * mapping, everything runs on the boot CPU.
 	 */
+	round.serial = !cpu_workers_follow_remap();
+	ncpus = round.serial ? 1 : cpu_workers_count();
 
-	/* Fill memory with a known pattern */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(offset, flags);
-		if (ret)
-			return ret;
-		start[offset] = offset + 1;
-	}
+	round_words = (resource_size_t)ncpus *
+		      MEMTEST_ROUND_BLOCKS * MEMTEST_BLOCK_WORDS;
+	round.start = start;
+	round.result = xmalloc(ncpus * MEMTEST_ROUND_BLOCKS *
+			       sizeof(*round.result));
 
-	/* Check each location and invert it for the second pass */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(num_words + offset, flags);
-		if (ret)
-			return ret;
+	time = get_time_ns();
 
-		temp = start[offset];
-		if (temp != (offset + 1)) {
-			printf("\n");
-			mem_test_report_failure("read/write",
-						(offset + 1),
-						temp, &start[offset]);
-			return -EIO;
-		}
+	for (i = 0; i < ARRAY_SIZE(pass); i++) {
+		round.pass = pass[i];
 
-		anti_pattern = ~(offset + 1);
-		start[offset] = anti_pattern;
-	}
+		for (offset = 0; offset < num_words; offset += round.num_words) {
+			ret = update_progress(i * num_words + offset, flags);
+			if (ret)
+				goto out;
 
-	/* Check each location for the inverted pattern and zero it */
-	for (offset = 0; offset < num_words; offset++) {
-		ret = update_progress(2 * num_words + offset, flags);
-		if (ret)
-			return ret;
+			round.offset = offset;
+			round.num_words = min_t(resource_size_t,
+						num_words - offset, round_words);
 
-		anti_pattern = ~(offset + 1);
-		temp = start[offset];
+			failed = mem_test_run_round(&round);
+			if (failed == offset + round.num_words)
+				continue;
 
-		if (temp != anti_pattern) {
 			printf("\n");
 			mem_test_report_failure("read/write",
-						anti_pattern,
-						temp, &start[offset]);
-			return -EIO;
+						i == 1 ? failed + 1 : ~(failed + 1),
+						start[failed], &start[failed]);
+			ret = -EIO;
+			goto out;
 		}
-
-		start[offset] = 0;
 	}
+
+	time = get_time_ns() - time;
+
 	if (flags & MEMTEST_VERBOSE) {
 		show_progress(3 * num_words);
 
 		/* end of progressbar */
 		printf("\n");
+
+		mem_test_report_throughput(num_words * sizeof(resource_size_t),
+					   requested, time);
 	}
 
-	return 0;
+out:
+	free(round.result);
+
+	return ret;
 }
@@ -297,6 +297,8 @@ static void __noreturn do_panic(bool stacktrace, const char *fmt, va_list ap)
 
 	led_trigger(LED_TRIGGER_PANIC, TRIGGER_ENABLE);
 
+	console_flush();
+
 	if (IS_ENABLED(CONFIG_PANIC_HANG))
 		hang();
 
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #include <common.h>
+#include <clock.h>
 #include <environment.h>
 #include <fdt.h>
 #include <of.h>
@@ -8,6 +9,7 @@
 #include <fs.h>
 #include <malloc.h>
 #include <linux/ctype.h>
+#include <linux/math64.h>
 #include <asm/byteorder.h>
 #include <errno.h>
 #include <getopt.h>
@@ -349,28 +351,66 @@ int of_register_set_status_fixup(const char *path, bool status)
 	data->path = path;
 	data->status = status;
 
-	return of_register_fixup(of_fixup_status, (void *)data);
+	return of_register_tree_fixup(of_fixup_status, (void *)data);
 }
 
 LIST_HEAD(of_fixup_list);
+static unsigned long of_fixup_generation;
 
 static inline bool of_fixup_disabled(struct of_fixup *fixup)
 {
     return fixup->disabled;
 }
 
-int of_register_fixup(int (*fixup)(struct device_node *, void *), void *context)
+/**
+ * of_fixups_changed - notify that the set of active fixups changed
+ *
+ * Must be called after enabling or disabling a fixup, so that the tree
+ * cached by of_get_fixed_tree() is recreated.
+ */
+void of_fixups_changed(void)
+{
+	of_fixup_generation++;
+}
+
+static int __of_register_fixup(int (*fixup)(struct device_node *, void *),
+			       void *context, bool tree_only)
 {
 	struct of_fixup *of_fixup = xzalloc(sizeof(*of_fixup));
 
 	of_fixup->fixup = fixup;
 	of_fixup->context = context;
+	of_fixup->tree_only = tree_only;
 
 	list_add_tail(&of_fixup->list, &of_fixup_list);
 
+	of_fixups_changed();
+
 	return 0;
 }
 
+int of_register_fixup(int (*fixup)(struct device_node *, void *), void *context)
+{
+	return __of_register_fixup(fixup, context, false);
+}
+
+/**
+ * of_register_tree_fixup - register a fixup only depending on the device tree
+ * @fixup: the fixup function
+ * @context: context passed to @fixup
+ *
+ * Like of_register_fixup(), but the result of @fixup must only depend on the
+ * device tree it is passed, on the live tree and on @context, which must not
+ * change after registration. With CONFIG_OF_FIXUP_CACHE, tree fixups are
+ * applied before all other fixups and their result is reused by
+ * of_get_fixed_tree() until the live tree changes.
+ */
+int of_register_tree_fixup(int (*fixup)(struct device_node *, void *),
+			   void *context)
+{
+	return __of_register_fixup(fixup, context, true);
+}
+
 /*
  * Remove a previously registered fixup. Only the first (if any) is removed.
  * Returns 0 if a match was found (and removed), -ENOENT otherwise.
@@ -383,6 +423,7 @@ int of_unregister_fixup(int (*fixup)(struct device_node *, void *),
 	list_for_each_entry(of_fixup, &of_fixup_list, list) {
 		if (of_fixup->fixup == fixup && of_fixup->context == context) {
 			list_del(&of_fixup->list);
+			of_fixups_changed();
 			return 0;
 		}
 	}
@@ -390,20 +431,24 @@ int of_unregister_fixup(int (*fixup)(struct device_node *, void *),
 	return -ENOENT;
 }
 
-/*
- * Apply registered fixups for the given fdt. The fdt must have
- * enough free space to apply the fixups.
- */
-void of_fix_tree(struct device_node *node)
+enum of_fixup_pass {
+	OF_FIXUP_ALL,
+	OF_FIXUP_TREE_ONLY,
+	OF_FIXUP_DYNAMIC,
+};
+
+static void __of_fix_tree(struct device_node *node, enum of_fixup_pass pass)
 {
 	struct of_fixup *of_fixup;
 	int ret;
 
-	of_overlay_load_firmware_clear();
-
 	list_for_each_entry(of_fixup, &of_fixup_list, list) {
 		if (of_fixup_disabled(of_fixup))
 			continue;
+		if (pass == OF_FIXUP_TREE_ONLY && !of_fixup->tree_only)
+			continue;
+		if (pass == OF_FIXUP_DYNAMIC && of_fixup->tree_only)
+			continue;
 
 		ret = of_fixup->fixup(node, of_fixup->context);
 		if (ret)
@@ -412,6 +457,87 @@ void of_fix_tree(struct device_node *node)
 	}
 }
 
+/*
+ * Apply registered fixups for the given fdt. The fdt must have
+ * enough free space to apply the fixups.
+ */
+void of_fix_tree(struct device_node *node)
+{
+	of_overlay_load_firmware_clear();
+
+	/* fix up other trees the same way as the cached live tree */
+	if (IS_ENABLED(CONFIG_OF_FIXUP_CACHE)) {
+		__of_fix_tree(node, OF_FIXUP_TREE_ONLY);
+		__of_fix_tree(node, OF_FIXUP_DYNAMIC);
+	} else {
+		__of_fix_tree(node, OF_FIXUP_ALL);
+	}
+}
+
+/*
+ * A copy of the live tree with only the tree fixups applied. It stays
+ * valid until the live tree or the set of fixups changes. The tree
+ * generation is recorded after of_get_fixed_live_tree() is done with its
+ * own copies, so modifying them doesn't invalidate the cache, even where
+ * the tree generation can't tell the live tree from copies.
+ */
+static struct {
+	struct device_node *root;
+	unsigned long tree_generation;
+	unsigned long fixup_generation;
+	unsigned int hits, misses;
+} of_fixed_cache;
+
+static struct fdt_header *of_get_fixed_live_tree(const struct device_node *node)
+{
+	struct fdt_header *fdt;
+	struct device_node *np;
+	u64 start = get_time_ns();
+	bool hit;
+
+	of_overlay_load_firmware_clear();
+
+	hit = of_fixed_cache.root &&
+	      of_fixed_cache.tree_generation == of_get_tree_generation() &&
+	      of_fixed_cache.fixup_generation == of_fixup_generation;
+
+	if (!hit) {
+		of_delete_node(of_fixed_cache.root);
+		of_fixed_cache.root = NULL;
+
+		np = of_dup(node);
+		if (!np)
+			return NULL;
+
+		__of_fix_tree(np, OF_FIXUP_TREE_ONLY);
+
+		of_fixed_cache.root = np;
+		of_fixed_cache.fixup_generation = of_fixup_generation;
+		of_fixed_cache.misses++;
+	} else {
+		of_fixed_cache.hits++;
+	}
+
+	np = of_dup(of_fixed_cache.root);
+	if (!np)
+		return NULL;
+
+	__of_fix_tree(np, OF_FIXUP_DYNAMIC);
+
+	fdt = of_flatten_dtb(np);
+
+	of_delete_node(np);
+
+	of_fixed_cache.tree_generation = of_get_tree_generation();
+
+	pr_debug("fixed tree %s in %llu us (%u hits, %u misses)\n",
+		 hit ? "from cache" : "created",
+		 div_u64(get_time_ns() - start, USECOND),
+		 of_fixed_cache.hits, of_fixed_cache.misses);
+
+	return fdt;
+}
+
 /*
  * Get the fixed fdt. This function uses the fdt input pointer
  * if provided or the barebox internal devicetree if not.
@@ -429,6 +555,9 @@ struct fdt_header *of_get_fixed_tree(const struct device_node *node)
 			return NULL;
 	}
 
+	if (IS_ENABLED(CONFIG_OF_FIXUP_CACHE) && node == of_get_root_node())
+		return of_get_fixed_live_tree(node);
+
 	np = of_dup(node);
 
 	if (!np)
@@ -104,6 +104,8 @@ int serdev_device_write(struct serdev_device *serdev, const unsigned char *buf,
 {
 	struct console_device *cdev = to_console_device(serdev);
 
+	console_tx_flush(cdev);
+
 	while (count--)
 		cdev->putc(cdev, *buf++);
 	/*
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Verification of payloads that are hashed in independent, fixed size
+ * chunks. The digests of all chunks are stored back to back and only
+ * their concatenation needs to be authenticated, e.g. by hashing it once
+ * more and comparing against a signed value. This allows verifying any
+ * range of the payload without hashing the rest and spreading the work
+ * over all available CPUs.
+ */
+
+#define pr_fmt(fmt) "digest-chunks: " fmt
+
+#include <common.h>
+#include <digest.h>
+#include <malloc.h>
+#include <crypto.h>
+#include <cpu-workers.h>
+
+struct digest_chunks_group {
+	struct digest *d;
+	u8 *md;
+	size_t first;
+	size_t n;
+	size_t bad;
+	int ret;
+};
+
+struct digest_chunks_job {
+	const u8 *data;
+	size_t size;
+	size_t chunk_size;
+	const u8 *chunk_hashes;
+	struct digest_chunks_group *groups;
+};
+
+/* Runs on any CPU, so must neither allocate nor print */
+static void digest_chunks_work(unsigned int item, void *data)
+{
+	struct digest_chunks_job *job = data;
+	struct digest_chunks_group *g = &job->groups[item];
+	unsigned int len = digest_length(g->d);
+	size_t i;
+
+	for (i = g->first; i < g->first + g->n; i++) {
+		size_t ofs = i * job->chunk_size;
+		size_t now = min(job->chunk_size, job->size - ofs);
+
+		g->ret = digest_init(g->d);
+		if (!g->ret)
+			g->ret = digest_update(g->d, job->data + ofs, now);
+		if (!g->ret)
+			g->ret = digest_final(g->d, g->md);
+		if (g->ret)
+			return;
+
+		if (crypto_memneq(g->md, job->chunk_hashes + i * len, len)) {
+			g->bad = i;
+			g->ret = -EBADMSG;
+			return;
+		}
+	}
+}
+
+/**
+ * digest_chunks_verify - verify a range of chunks of a payload
+ * @algo: digest algorithm used for the chunks
+ * @data: start of the payload
+ * @size: size of the payload
+ * @chunk_size: size of each chunk, only the last one may be shorter
+ * @chunk_hashes: digests of all chunks of the payload, back to back
+ * @first: index of the first chunk to verify
+ * @nchunks: number of chunks to verify
+ *
+ * The caller is responsible for authenticating @chunk_hashes.
+ *
+ * Return: 0 if all chunks match, -EBADMSG if at least one doesn't,
+ * other negative error codes otherwise.
+ */
+int digest_chunks_verify(const char *algo, const void *data, size_t size,
+			 size_t chunk_size, const void *chunk_hashes,
+			 size_t first, size_t nchunks)
+{
+	struct digest_chunks_job job = {
+		.data = data,
+		.size = size,
+		.chunk_size = chunk_size,
+		.chunk_hashes = chunk_hashes,
+	};
+	unsigned int ngroups, i;
+	size_t per_group;
+	int ret = 0;
+
+	if (!chunk_size || first + nchunks > DIV_ROUND_UP(size, chunk_size))
+		return -EINVAL;
+
+	if (!nchunks)
+		return 0;
+
+	ngroups = min_t(size_t, cpu_workers_count(), nchunks);
+	per_group = DIV_ROUND_UP(nchunks, ngroups);
+	ngroups = DIV_ROUND_UP(nchunks, per_group);
+
+	job.groups = xzalloc(ngroups * sizeof(*job.groups));
+
+	for (i = 0; i < ngroups; i++) {
+		struct digest_chunks_group *g = &job.groups[i];
+
+		g->d = digest_alloc(algo);
+		if (!g->d) {
+			ret = -ENOENT;
+			goto out;
+		}
+
+		g->md = xmalloc(digest_length(g->d));
+		g->first = first + i * per_group;
+		g->n = min(per_group, first + nchunks - g->first);
+	}
+
+	cpu_workers_run(digest_chunks_work, &job, ngroups);
+
+	for (i = 0; i < ngroups; i++) {
+		struct digest_chunks_group *g = &job.groups[i];
+
+		if (g->ret == -EBADMSG)
+			pr_err("chunk %zu at 0x%zx: hash BAD\n", g->bad,
+			       g->bad * chunk_size);
+		if (g->ret && !ret)
+			ret = g->ret;
+	}
+
+out:
+	for (i = 0; i < ngroups; i++) {
+		digest_free(job.groups[i].d);
+		free(job.groups[i].md);
+	}
+	free(job.groups);
+
+	return ret;
+}
+EXPORT_SYMBOL(digest_chunks_verify);
@@ -5,9 +5,25 @@
 #include <crypto/public_key.h>
 #include <crypto/rsa.h>
 #include <crypto/ecdsa.h>
+#include <crypto/sha.h>
+#include <digest.h>
 
 static LIST_HEAD(public_keys);
 
+#define PUBLIC_KEY_HASH_BITS	4
+
+/*
+ * Keys are additionally hashed by the low PUBLIC_KEY_HASH_BITS bits of the
+ * first byte of their fingerprint. As the fingerprint is a SHA-256 digest it
+ * is evenly distributed already.
+ */
+static struct hlist_head public_key_hash[1 << PUBLIC_KEY_HASH_BITS];
+
+static struct hlist_head *public_key_hash_head(const unsigned char *fp)
+{
+	return &public_key_hash[fp[0] & ((1 << PUBLIC_KEY_HASH_BITS) - 1)];
+}
+
 const struct public_key *public_key_next(const struct public_key *prev)
 {
 	prev = list_prepare_entry(prev, &public_keys, list);
@@ -29,16 +45,140 @@ const struct public_key *public_key_get(const char *name)
 	return NULL;
 }
 
+const struct public_key *public_key_get_by_fingerprint(const void *fp,
+							size_t len)
+{
+	const struct public_key *key;
+
+	if (len != SHA256_DIGEST_SIZE)
+		return NULL;
+
+	hlist_for_each_entry(key, public_key_hash_head(fp), hash_node) {
+		if (!memcmp(key->fingerprint, fp, SHA256_DIGEST_SIZE))
+			return key;
+	}
+
+	return NULL;
+}
+
+static void digest_update_be32(struct digest *d, const uint32_t *words,
+			       unsigned int nwords)
+{
+	int i;
+
+	/* words are stored least significant first */
+	for (i = nwords - 1; i >= 0; i--) {
+		__be32 w = cpu_to_be32(words[i]);
+
+		digest_update(d, &w, sizeof(w));
+	}
+}
+
+static void digest_update_be64(struct digest *d, const uint64_t *words,
+			       unsigned int nwords)
+{
+	int i;
+
+	/* words are stored least significant first */
+	for (i = nwords - 1; i >= 0; i--) {
+		__be64 w = cpu_to_be64(words[i]);
+
+		digest_update(d, &w, sizeof(w));
+	}
+}
+
+/*
+ * The fingerprint of a key is the SHA-256 over its big endian public key
+ * material: the modulus for RSA keys and the concatenation of the x and y
+ * coordinates for ECDSA keys. This is what a FIT signature node may carry
+ * in its "key-fingerprint" property.
+ */
+static int public_key_fingerprint(struct public_key *key)
+{
+	struct digest *d;
+	unsigned int ndigits;
+	int ret;
+
+	d = digest_alloc_by_algo(HASH_ALGO_SHA256);
+	if (!d)
+		return -ENOSYS;
+
+	ret = digest_init(d);
+	if (ret)
+		goto out;
+
+	switch (key->type) {
+	case PUBLIC_KEY_TYPE_RSA:
+		digest_update_be32(d, key->rsa->modulus, key->rsa->len);
+		break;
+	case PUBLIC_KEY_TYPE_ECDSA:
+		ndigits = DIV_ROUND_UP(key->ecdsa->size_bits, 64);
+		digest_update_be64(d, key->ecdsa->x, ndigits);
+		digest_update_be64(d, key->ecdsa->y, ndigits);
+		break;
+	default:
+		ret = -ENOKEY;
+		goto out;
+	}
+
+	ret = digest_final(d, key->fingerprint);
+out:
+	digest_free(d);
+
+	return ret;
+}
+
 int public_key_add(struct public_key *key)
 {
+	int ret;
+
 	if (public_key_get(key->key_name_hint))
 		return -EEXIST;
 
+	ret = public_key_fingerprint(key);
+	if (ret) {
+		pr_debug("%s: no fingerprint: %pe\n", key->key_name_hint,
+			 ERR_PTR(ret));
+	} else if (!public_key_get_by_fingerprint(key->fingerprint,
+						  SHA256_DIGEST_SIZE)) {
+		/* only the first of several keys with equal material is indexed */
+		hlist_add_head(&key->hash_node,
+			       public_key_hash_head(key->fingerprint));
+	}
+
 	list_add_tail(&key->list, &public_keys);
 
 	return 0;
 }
 
+/**
+ * public_key_del - remove a key from the keyring
+ * @key: the key to remove, previously added with public_key_add()
+ *
+ * The key itself is not freed.
+ */
+void public_key_del(struct public_key *key)
+{
+	struct public_key *k;
+
+	list_del(&key->list);
+
+	if (hlist_unhashed(&key->hash_node))
+		return;
+
+	hlist_del_init(&key->hash_node);
+
+	/* index the next key with the same material in its place */
+	list_for_each_entry(k, &public_keys, list) {
+		if (!memcmp(k->fingerprint, key->fingerprint,
+			    SHA256_DIGEST_SIZE)) {
+			hlist_add_head(&k->hash_node,
+				       public_key_hash_head(k->fingerprint));
+			break;
+		}
+	}
+}
+
 static struct public_key *public_key_dup(const struct public_key *key)
 {
 	struct public_key *k = xzalloc(sizeof(*k));
@@ -30,6 +30,7 @@
 #include <pinctrl.h>
 #include <featctrl.h>
 #include <linux/clk/clk-conf.h>
+#include <linux/hash.h>
 
 #ifdef CONFIG_DEBUG_PROBES
 #define pr_report_probe		pr_info
@@ -47,6 +48,24 @@ LIST_HEAD(active_device_list);
 EXPORT_SYMBOL(active_device_list);
 static LIST_HEAD(deferred);
 
+/*
+ * While device_probe_deferred() runs, the nodes of all devices that get bound
+ * are recorded, so that only the consumers of these devices are retried.
+ */
+static bool deferred_track_bound;
+static struct device_node **deferred_bound;
+static int deferred_num_bound;
+
+static void device_deferred_record_bound(struct device *dev)
+{
+	if (!deferred_track_bound || !dev->of_node)
+		return;
+
+	deferred_bound = xrealloc(deferred_bound,
+				  (deferred_num_bound + 1) * sizeof(*deferred_bound));
+	deferred_bound[deferred_num_bound++] = dev->of_node;
+}
+
 static LIST_HEAD(device_alias_list);
 
 struct device *find_device(const char *str)
@@ -106,6 +125,71 @@ int get_free_deviceid(const char *name_template)
 	};
 }
 
+static struct device *device_find_supplier(struct device_node *np)
+{
+	struct device *dev;
+
+	/* pinctrl states, nvmem cells etc. are subnodes of their provider */
+	for (; np; np = np->parent) {
+		dev = of_find_device_by_node(np);
+		if (dev)
+			return dev;
+	}
+
+	return NULL;
+}
+
+static bool device_is_deferred(struct device *dev)
+{
+	struct device *d;
+
+	list_for_each_entry(d, &deferred, active)
+		if (d == dev)
+			return true;
+
+	return false;
+}
+
+#define DEFERRAL_REPORT_MAX_DEPTH	4
+
+static void dev_report_deferral_suppliers(struct device *dev, int depth)
+{
+	struct device_node **suppliers;
+	struct device *supplier;
+	int i, num;
+
+	num = of_get_suppliers(dev->of_node, &suppliers);
+
+	for (i = 0; i < num; i++) {
+		supplier = device_find_supplier(suppliers[i]);
+
+		if (supplier && supplier->driver)
+			continue;
+
+		if (!supplier) {
+			pr_err("%*swaits for %pOF (no device)\n", depth * 2, "",
+			       suppliers[i]);
+			continue;
+		}
+
+		if (!device_is_deferred(supplier)) {
+			pr_err("%*swaits for %s (not probed)\n", depth * 2, "",
+			       dev_name(supplier));
+			continue;
+		}
+
+		pr_err("%*swaits for %s (probe deferred%s%s)\n", depth * 2, "",
+		       dev_name(supplier),
+		       supplier->deferred_probe_reason ? ": " : "",
+		       supplier->deferred_probe_reason ?: "");
+
+		if (depth < DEFERRAL_REPORT_MAX_DEPTH)
+			dev_report_deferral_suppliers(supplier, depth + 1);
+	}
+
+	free(suppliers);
+}
+
 static void dev_report_permanent_probe_deferral(struct device *dev)
 {
 	if (dev->deferred_probe_reason)
@@ -113,6 +197,8 @@ static void dev_report_permanent_probe_deferral(struct device *dev)
 			dev->deferred_probe_reason);
 	else
 		dev_err(dev, "probe permanently deferred\n");
+
+	dev_report_deferral_suppliers(dev, 1);
 }
 
 int device_probe(struct device *dev)
@@ -148,6 +234,7 @@ int device_probe(struct device *dev)
 
 	switch (ret) {
 	case 0:
+		device_deferred_record_bound(dev);
 		return 0;
 	case -EPROBE_DEFER:
 		/*
@@ -238,10 +325,193 @@ static int match(struct driver *drv, struct device *dev)
 	return -1;
 }
 
-int register_device(struct device *new_device)
+/*
+ * Index of the compatibles of all registered drivers. When a device with a
+ * device tree node is registered on a bus matching with device_match(),
+ * only the drivers listed for the node's compatibles (plus the drivers
+ * without a compatible table, which match by name) are tried instead of
+ * all drivers of the bus. Candidates are tried in registration order, so
+ * the result is the same as when walking the bus's driver list.
+ */
+#define DRIVER_COMPAT_HASH_BITS	10
+
+struct driver_compat {
+	struct hlist_node node;
+	const char *compatible;	/* NULL for drivers without compatible table */
+	u32 hash;
+	unsigned int seq;
+	struct driver *drv;
+};
+
+static struct hlist_head driver_compat_hash[1 << DRIVER_COMPAT_HASH_BITS];
+static HLIST_HEAD(driver_compat_any);
+static unsigned int driver_compat_seq;
+
+static u32 driver_compat_hash_str(const char *str)
+{
+	u32 hash = 0;
+
+	/* compatibles are compared case insensitive */
+	while (*str)
+		hash = hash * 31 + tolower(*str++);
+
+	return hash;
+}
+
+static void driver_compat_add(struct driver *drv, const char *compatible,
+			      unsigned int seq)
+{
+	struct driver_compat *dc = xzalloc(sizeof(*dc));
+
+	dc->drv = drv;
+	dc->seq = seq;
+	dc->compatible = compatible;
+
+	if (!compatible) {
+		hlist_add_head(&dc->node, &driver_compat_any);
+		return;
+	}
+
+	dc->hash = driver_compat_hash_str(compatible);
+	hlist_add_head(&dc->node, &driver_compat_hash[hash_32(dc->hash,
+						DRIVER_COMPAT_HASH_BITS)]);
+}
+
+static void driver_compat_register(struct driver *drv)
+{
+	const struct of_device_id *id;
+	unsigned int seq = driver_compat_seq++;
+
+	if (!IS_ENABLED(CONFIG_OFDEVICE))
+		return;
+
+	if (!drv->of_compatible) {
+		driver_compat_add(drv, NULL, seq);
+		return;
+	}
+
+	for (id = drv->of_compatible; id->compatible; id++)
+		driver_compat_add(drv, id->compatible, seq);
+}
+
+static void driver_compat_unregister_list(struct hlist_head *head,
+					  struct driver *drv)
+{
+	struct driver_compat *dc;
+	struct hlist_node *tmp;
+
+	hlist_for_each_entry_safe(dc, tmp, head, node) {
+		if (dc->drv != drv)
+			continue;
+
+		hlist_del(&dc->node);
+		free(dc);
+	}
+}
+
+static void driver_compat_unregister(struct driver *drv)
+{
+	int i;
+
+	if (!IS_ENABLED(CONFIG_OFDEVICE))
+		return;
+
+	driver_compat_unregister_list(&driver_compat_any, drv);
+
+	for (i = 0; i < ARRAY_SIZE(driver_compat_hash); i++)
+		driver_compat_unregister_list(&driver_compat_hash[i], drv);
+}
+
+static bool driver_compat_indexed(struct device *dev)
+{
+	return IS_ENABLED(CONFIG_OFDEVICE) && dev->of_node &&
+		dev->bus->match == device_match;
+}
+
+static void driver_compat_candidate(struct driver_compat ***cand, int *num,
+				    int *size, struct driver_compat *dc)
+{
+	int i;
+
+	for (i = 0; i < *num; i++) {
+		if ((*cand)[i]->drv == dc->drv)
+			return;
+	}
+
+	if (*num == *size) {
+		*size = *size ? *size * 2 : 8;
+		*cand = xrealloc(*cand, *size * sizeof(**cand));
+	}
+
+	/* keep candidates sorted by registration order */
+	for (i = *num; i > 0 && (*cand)[i - 1]->seq > dc->seq; i--)
+		(*cand)[i] = (*cand)[i - 1];
+
+	(*cand)[i] = dc;
+	(*num)++;
+}
+
+static int driver_compat_bind(struct device *dev)
+{
+	struct driver_compat **cand = NULL, *dc;
+	const struct property *prop;
+	const char *compat;
+	int i, num = 0, size = 0, ret = -ENODEV;
+
+	of_property_for_each_string(dev->of_node, "compatible", prop, compat) {
+		u32 hash = driver_compat_hash_str(compat);
+		struct hlist_head *head;
+
+		head = &driver_compat_hash[hash_32(hash, DRIVER_COMPAT_HASH_BITS)];
+
+		hlist_for_each_entry(dc, head, node) {
+			if (dc->hash != hash || dc->drv->bus != dev->bus ||
+			    of_compat_cmp(dc->compatible, compat, 0))
+				continue;
+
+			driver_compat_candidate(&cand, &num, &size, dc);
+		}
+	}
+
+	hlist_for_each_entry(dc, &driver_compat_any, node) {
+		if (dc->drv->bus == dev->bus)
+			driver_compat_candidate(&cand, &num, &size, dc);
+	}
+
+	for (i = 0; i < num; i++) {
+		if (!match(cand[i]->drv, dev)) {
+			ret = 0;
+			break;
+		}
+	}
+
+	free(cand);
+
+	return ret;
+}
+
+/*
+ * Try the drivers of the device's bus until one of them binds to it.
+ * Returns 0 when a driver was bound.
+ */
+static int device_bind_driver(struct device *dev)
 {
 	struct driver *drv;
 
+	if (driver_compat_indexed(dev))
+		return driver_compat_bind(dev);
+
+	bus_for_each_driver(dev->bus, drv) {
+		if (!match(drv, dev))
+			return 0;
+	}
+
+	return -ENODEV;
+}
+
+int register_device(struct device *new_device)
+{
+
 	if (new_device->id == DEVICE_ID_DYNAMIC) {
 		new_device->id = get_free_deviceid(new_device->name);
 	} else {
@@ -273,10 +543,7 @@ int register_device(struct device *new_device)
 
 		list_add_tail(&new_device->bus_list, &new_device->bus->device_list);
 
-		bus_for_each_driver(new_device->bus, drv) {
-			if (!match(drv, new_device))
-				break;
-		}
+		device_bind_driver(new_device);
 	}
 
 	if (new_device->parent)
@@ -365,38 +632,118 @@ void free_device(struct device *dev)
 }
 EXPORT_SYMBOL(free_device);
 
+struct deferred_suppliers {
+	struct list_head list;
+	struct device *dev;
+	struct device_node **nodes;
+	int num;
+};
+
+static struct deferred_suppliers *device_deferred_suppliers(struct list_head *cache,
+							    struct device *dev)
+{
+	struct deferred_suppliers *ds;
+
+	list_for_each_entry(ds, cache, list)
+		if (ds->dev == dev)
+			return ds;
+
+	ds = xzalloc(sizeof(*ds));
+	ds->dev = dev;
+	ds->num = of_get_suppliers(dev->of_node, &ds->nodes);
+	list_add(&ds->list, cache);
+
+	return ds;
+}
+
+/*
+ * Returns true if @dev may have been waiting for one of the @num devices
+ * with the nodes @bound that were just bound.
+ */
+static bool device_deferred_consumer_of(struct list_head *cache,
+					struct device *dev,
+					struct device_node **bound, int num)
+{
+	struct deferred_suppliers *ds = device_deferred_suppliers(cache, dev);
+	struct device_node *np;
+	int i, j;
+
+	/* We don't know what the device is waiting for, so always retry */
+	if (!ds->num)
+		return true;
+
+	for (i = 0; i < ds->num; i++) {
+		for (np = ds->nodes[i]; np; np = np->parent) {
+			for (j = 0; j < num; j++) {
+				if (np == bound[j])
+					return true;
+			}
+		}
+	}
+
+	return false;
+}
+
 /*
- * Loop over list of deferred devices as long as at least one
- * device is successfully probed. Devices that again request
- * deferral are re-added to deferred list in device_probe().
- * For devices finally left in deferred list -EPROBE_DEFER
+ * Retry the deferred devices as long as at least one device is successfully
+ * probed. Devices that again request deferral are re-added to deferred list
+ * in device_probe(). For devices finally left in deferred list -EPROBE_DEFER
  * becomes a fatal error.
+ *
+ * After a first pass over all deferred devices, only the devices consuming
+ * resources (as found by of_get_suppliers()) of devices bound in the previous
+ * pass are retried. When that makes no progress, another pass over all
+ * deferred devices is done for dependencies not described in the device
+ * tree, so the outcome is the same as when always retrying all devices.
  */
 static int device_probe_deferred(void)
 {
 	struct device *dev, *tmp;
-	struct driver *drv;
-	bool success;
+	struct device_node **bound = NULL;
+	struct deferred_suppliers *ds, *dstmp;
+	LIST_HEAD(cache);
+	bool success, all = true;
+	int num_bound = 0;
 
-	do {
-		success = false;
+	deferred_track_bound = true;
 
-		if (list_empty(&deferred))
-			return 0;
+	while (!list_empty(&deferred)) {
+		success = false;
 
 		list_for_each_entry_safe(dev, tmp, &deferred, active) {
+			if (!all && !device_deferred_consumer_of(&cache, dev,
+								 bound, num_bound))
+				continue;
+
 			list_del(&dev->active);
 			INIT_LIST_HEAD(&dev->active);
 
 			dev_dbg(dev, "re-probe device\n");
-			bus_for_each_driver(dev->bus, drv) {
-				if (match(drv, dev))
-					continue;
+			if (!device_bind_driver(dev))
 				success = true;
-				break;
-			}
 		}
-	} while (success);
+
+		free(bound);
+		bound = deferred_bound;
+		num_bound = deferred_num_bound;
+		deferred_bound = NULL;
+		deferred_num_bound = 0;
+
+		if (success)
+			all = false;
+		else if (all)
+			break;
+		else
+			all = true;
+	}
+
+	deferred_track_bound = false;
+	free(bound);
+
+	list_for_each_entry_safe(ds, dstmp, &cache, list) {
+		free(ds->nodes);
+		free(ds);
+	}
 
 	list_for_each_entry(dev, &deferred, active)
 		dev_report_permanent_probe_deferral(dev);
@@ -430,6 +777,7 @@ int register_driver(struct driver *drv)
 
 	list_add_tail(&drv->list, &driver_list);
 	list_add_tail(&drv->bus_list, &drv->bus->driver_list);
+	driver_compat_register(drv);
 
 	bus_for_each_device(drv->bus, dev)
 		match(drv, dev);
@@ -444,6 +792,7 @@ void unregister_driver(struct driver *drv)
 
 	list_del(&drv->list);
 	list_del(&drv->bus_list);
+	driver_compat_unregister(drv);
 
 	bus_for_each_device(drv->bus, dev) {
 		if (dev->driver == drv) {
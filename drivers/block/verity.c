@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Read-only block device verifying every block read from an underlying
+ * device against a dm-verity (format 1) hash tree. Only the blocks that
+ * are actually read are hashed. Hash blocks are kept in memory once they
+ * have been verified, so each of them is read and hashed at most once.
+ */
+
+#define pr_fmt(fmt) "verity: " fmt
+
+#include <common.h>
+#include <driver.h>
+#include <block.h>
+#include <disks.h>
+#include <digest.h>
+#include <malloc.h>
+#include <fcntl.h>
+#include <verity.h>
+#include <linux/log2.h>
+
+#define VERITY_MAX_LEVELS	63
+
+struct verity_superblock {
+	u8 signature[8];	/* "verity\0\0" */
+	__le32 version;		/* superblock version, 1 */
+	__le32 hash_type;	/* 0 - Chrome OS, 1 - normal */
+	u8 uuid[16];
+	u8 algorithm[32];
+	__le32 data_block_size;
+	__le32 hash_block_size;
+	__le64 data_blocks;
+	__le16 salt_size;
+	u8 _pad1[6];
+	u8 salt[256];
+	u8 _pad2[168];
+} __packed;
+
+struct verity {
+	struct device dev;
+	struct block_device blk;
+	struct cdev *data;
+	struct cdev *hash;
+	struct verity_params params;
+
+	struct digest *d;
+	unsigned int digest_size;
+	unsigned int hash_block_bits;
+	unsigned int hash_per_block_bits;
+	int levels;
+	u64 hash_level_block[VERITY_MAX_LEVELS];
+	u64 hash_blocks;
+
+	/* verified hash blocks, indexed relative to params.hash_start */
+	u8 **hash_cache;
+	u8 want[VERITY_MAX_DIGEST_SIZE];
+	u8 result[VERITY_MAX_DIGEST_SIZE];
+};
+
+int verity_read_superblock(struct cdev *hash, loff_t offset,
+			   struct verity_params *params)
+{
+	struct verity_superblock sb;
+	ssize_t ret;
+
+	ret = cdev_read(hash, &sb, sizeof(sb), offset, 0);
+	if (ret < 0)
+		return ret;
+	if (ret != sizeof(sb))
+		return -EIO;
+
+	if (memcmp(sb.signature, "verity\0\0", sizeof(sb.signature)))
+		return -EINVAL;
+
+	if (le32_to_cpu(sb.version) != 1 || le32_to_cpu(sb.hash_type) != 1) {
+		pr_err("unsupported superblock version %u, hash type %u\n",
+		       le32_to_cpu(sb.version), le32_to_cpu(sb.hash_type));
+		return -ENOTSUPP;
+	}
+
+	if (le16_to_cpu(sb.salt_size) > sizeof(sb.salt))
+		return -EINVAL;
+
+	strscpy(params->algo, sb.algorithm,
+		min(sizeof(params->algo), sizeof(sb.algorithm) + 1));
+	params->data_block_size = le32_to_cpu(sb.data_block_size);
+	params->hash_block_size = le32_to_cpu(sb.hash_block_size);
+	params->data_blocks = le64_to_cpu(sb.data_blocks);
+	params->salt_size = le16_to_cpu(sb.salt_size);
+	memcpy(params->salt, sb.salt, params->salt_size);
+
+	if (!params->hash_block_size)
+		return -EINVAL;
+
+	params->hash_start = offset + ALIGN(sizeof(sb), params->hash_block_size);
+
+	return 0;
+}
+EXPORT_SYMBOL(verity_read_superblock);
+
+static int verity_hash(struct verity *v, const void *data, size_t len, u8 *md)
+{
+	int ret;
+
+	ret = digest_init(v->d);
+	if (ret)
+		return ret;
+
+	ret = digest_update(v->d, v->params.salt, v->params.salt_size);
+	if (ret)
+		return ret;
+
+	ret = digest_update(v->d, data, len);
+	if (ret)
+		return ret;
+
+	return digest_final(v->d, md);
+}
+
+/*
+ * Returns the contents of hash block @hblock, reading it and checking it
+ * against v->want unless it has been verified before.
+ */
+static const u8 *verity_get_hash_block(struct verity *v, u64 hblock)
+{
+	size_t size = v->params.hash_block_size;
+	ssize_t ret;
+	u8 *buf;
+
+	if (v->hash_cache[hblock])
+		return v->hash_cache[hblock];
+
+	buf = malloc(size);
+	if (!buf)
+		return ERR_PTR(-ENOMEM);
+
+	ret = cdev_read(v->hash, buf, size,
+			v->params.hash_start + (hblock << v->hash_block_bits), 0);
+	if (ret >= 0 && ret != size)
+		ret = -EIO;
+	if (ret < 0)
+		goto err;
+
+	ret = verity_hash(v, buf, size, v->result);
+	if (ret)
+		goto err;
+
+	if (memcmp(v->result, v->want, v->digest_size)) {
+		dev_err(&v->dev, "hash block %llu is corrupted\n", hblock);
+		ret = -EBADMSG;
+		goto err;
+	}
+
+	v->hash_cache[hblock] = buf;
+
+	return buf;
+err:
+	free(buf);
+	return ERR_PTR(ret);
+}
+
+static int verity_verify_block(struct verity *v, u64 block, const void *data)
+{
+	unsigned int slot_bits = v->hash_block_bits - v->hash_per_block_bits;
+	u64 mask = (1ULL << v->hash_per_block_bits) - 1;
+	int level, ret;
+
+	memcpy(v->want, v->params.root_digest, v->digest_size);
+
+	/* walk down from the root, each level yields the digest for the next */
+	for (level = v->levels - 1; level >= 0; level--) {
+		u64 position = block >> (level * v->hash_per_block_bits);
+		u64 hblock = v->hash_level_block[level] +
+			     (position >> v->hash_per_block_bits);
+		const u8 *p;
+
+		p = verity_get_hash_block(v, hblock);
+		if (IS_ERR(p))
+			return PTR_ERR(p);
+
+		memcpy(v->want, p + ((position & mask) << slot_bits),
+		       v->digest_size);
+	}
+
+	ret = verity_hash(v, data, v->params.data_block_size, v->result);
+	if (ret)
+		return ret;
+
+	if (memcmp(v->result, v->want, v->digest_size)) {
+		dev_err(&v->dev, "data block %llu is corrupted\n", block);
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+static int verity_read(struct block_device *blk, void *buf,
+		       sector_t block, blkcnt_t num_blocks)
+{
+	struct verity *v = container_of(blk, struct verity, blk);
+	size_t size = (size_t)num_blocks << blk->blockbits;
+	ssize_t ret;
+	blkcnt_t i;
+
+	ret = cdev_read(v->data, buf, size, (loff_t)block << blk->blockbits, 0);
+	if (ret >= 0 && ret != size)
+		ret = -EIO;
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < num_blocks; i++) {
+		ret = verity_verify_block(v, block + i,
+					  buf + (i << blk->blockbits));
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static struct block_device_ops verity_ops = {
+	.read = verity_read,
+	/* no .write, the block layer refuses writes with -EROFS */
+};
+
+static int verity_init_tree(struct verity *v)
+{
+	const struct verity_params *p = &v->params;
+	u64 hash_position = 0;
+	int i;
+
+	v->hash_block_bits = ilog2(p->hash_block_size);
+	v->hash_per_block_bits = ilog2(p->hash_block_size / v->digest_size);
+
+	v->levels = 0;
+	while (v->hash_per_block_bits * v->levels < 64 &&
+	       (p->data_blocks - 1) >> (v->hash_per_block_bits * v->levels))
+		v->levels++;
+
+	if (v->levels > VERITY_MAX_LEVELS)
+		return -E2BIG;
+
+	for (i = v->levels - 1; i >= 0; i--) {
+		unsigned int shift = (i + 1) * v->hash_per_block_bits;
+		u64 blocks;
+
+		v->hash_level_block[i] = hash_position;
+		blocks = shift >= 64 ? 1 :
+			 (p->data_blocks + (1ULL << shift) - 1) >> shift;
+		hash_position += blocks;
+	}
+
+	v->hash_blocks = hash_position;
+
+	if (p->hash_start + (v->hash_blocks << v->hash_block_bits) >
+	    v->hash->size) {
+		pr_err("hash device too small for %llu hash blocks\n",
+		       v->hash_blocks);
+		return -EINVAL;
+	}
+
+	v->hash_cache = calloc(v->hash_blocks ?: 1, sizeof(*v->hash_cache));
+	if (!v->hash_cache)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static bool verity_block_size_valid(unsigned int size)
+{
+	return is_power_of_2(size) && size >= SECTOR_SIZE &&
+	       size <= PAGE_SIZE * 16;
+}
+
+/**
+ * verity_create - create a block device verifying reads against a hash tree
+ * @name: name of the new device
+ * @data: device holding the data blocks
+ * @hash: device holding the hash tree, may be the same as @data
+ * @params: hash tree parameters including the trusted root digest
+ *
+ * Return: the cdev of the new block device or an ERR_PTR on failure
+ */
+struct cdev *verity_create(const char *name, struct cdev *data,
+			   struct cdev *hash, const struct verity_params *params)
+{
+	struct verity *v;
+	int ret;
+
+	if (!verity_block_size_valid(params->data_block_size) ||
+	    !verity_block_size_valid(params->hash_block_size)) {
+		pr_err("unsupported block sizes %u/%u\n",
+		       params->data_block_size, params->hash_block_size);
+		return ERR_PTR(-EINVAL);
+	}
+
+	if (!params->data_blocks || params->salt_size > VERITY_MAX_SALT_SIZE)
+		return ERR_PTR(-EINVAL);
+
+	if (params->data_blocks * params->data_block_size > data->size) {
+		pr_err("%s too small for %llu data blocks\n", data->name,
+		       params->data_blocks);
+		return ERR_PTR(-EINVAL);
+	}
+
+	v = xzalloc(sizeof(*v));
+	v->data = data;
+	v->hash = hash;
+	v->params = *params;
+
+	v->d = digest_alloc(params->algo);
+	if (!v->d) {
+		pr_err("unsupported algorithm %s\n", params->algo);
+		ret = -ENOENT;
+		goto err_free;
+	}
+
+	v->digest_size = digest_length(v->d);
+	if (v->digest_size != params->root_digest_size) {
+		pr_err("root digest must be %u bytes for %s\n", v->digest_size,
+		       params->algo);
+		ret = -EINVAL;
+		goto err_digest;
+	}
+
+	/* a hash block must hold at least two digests to form a tree */
+	if (v->digest_size * 2 > params->hash_block_size) {
+		ret = -EINVAL;
+		goto err_digest;
+	}
+
+	ret = verity_init_tree(v);
+	if (ret)
+		goto err_digest;
+
+	v->dev.id = DEVICE_ID_DYNAMIC;
+	v->dev.parent = data->dev;
+	dev_set_name(&v->dev, "verity");
+
+	ret = register_device(&v->dev);
+	if (ret)
+		goto err_cache;
+
+	v->blk.dev = &v->dev;
+	v->blk.cdev.name = xstrdup(name);
+	v->blk.blockbits = ilog2(params->data_block_size);
+	v->blk.num_blocks = params->data_blocks;
+	v->blk.ops = &verity_ops;
+	v->blk.type = BLK_TYPE_VIRTUAL;
+
+	ret = blockdevice_register(&v->blk);
+	if (ret)
+		goto err_unregister;
+
+	dev_info(&v->dev, "%s: %llu blocks on %s, hash tree of %d levels on %s\n",
+		 name, params->data_blocks, data->name, v->levels, hash->name);
+
+	return &v->blk.cdev;
+
+err_unregister:
+	free(v->blk.cdev.name);
+	unregister_device(&v->dev);
+err_cache:
+	free(v->hash_cache);
+err_digest:
+	digest_free(v->d);
+err_free:
+	free(v);
+
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL(verity_create);
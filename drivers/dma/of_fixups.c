@@ -39,6 +39,6 @@ static int of_dma_coherent_fixup_register(void)
 	if (!soc)
 		return -ENOENT;
 
-	return of_register_fixup(of_dma_coherent_fixup, soc);
+	return of_register_tree_fixup(of_dma_coherent_fixup, soc);
 }
 coredevice_initcall(of_dma_coherent_fixup_register);
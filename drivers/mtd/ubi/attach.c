@@ -919,6 +919,24 @@ static bool vol_ignored(int vol_id)
 #endif
 }
 
+/**
+ * alloc_hdrs_buf - allocate a buffer for reading EC and VID header at once.
+ * @ubi: UBI device description object
+ *
+ * Returns %NULL if the layout of @ubi does not allow reading both headers
+ * with one flash operation or memory is short. Scanning then falls back to
+ * reading the headers separately.
+ */
+static void *alloc_hdrs_buf(const struct ubi_device *ubi)
+{
+	int len = ubi_io_hdrs_len(ubi);
+
+	if (!len)
+		return NULL;
+
+	return kmalloc(len, GFP_KERNEL);
+}
+
 /**
  * scan_peb - scan and process UBI headers of a PEB.
  * @ubi: UBI device description object
@@ -938,7 +956,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	struct ubi_vid_io_buf *vidb = ai->vidb;
 	struct ubi_vid_hdr *vidh = ubi_get_vid_hdr(vidb);
 	long long ec;
-	int err, bitflips = 0, vol_id = -1, ec_err = 0;
+	int err, bitflips = 0, vol_id = -1, ec_err = 0, vid_err = 0;
 
 	dbg_bld("scan PEB %d", pnum);
 
@@ -951,7 +969,11 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	if (ai->hdrs_buf)
+		err = ubi_io_read_hdrs(ubi, pnum, ech, vidb, ai->hdrs_buf,
+				       &vid_err);
+	else
+		err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1034,7 +1056,10 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+	if (ai->hdrs_buf)
+		err = vid_err;
+	else
+		err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1380,6 +1405,8 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!ai->vidb)
 		goto out_ech;
 
+	ai->hdrs_buf = alloc_hdrs_buf(ubi);
+
 	for (pnum = start; pnum < ubi->peb_count; pnum++) {
 		dbg_gen("process PEB %d", pnum);
 		err = scan_peb(ubi, ai, pnum, false);
@@ -1424,12 +1451,16 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (err)
 		goto out_vidh;
 
+	kfree(ai->hdrs_buf);
+	ai->hdrs_buf = NULL;
 	ubi_free_vid_buf(ai->vidb);
 	kfree(ai->ech);
 
 	return 0;
 
 out_vidh:
+	kfree(ai->hdrs_buf);
+	ai->hdrs_buf = NULL;
 	ubi_free_vid_buf(ai->vidb);
 out_ech:
 	kfree(ai->ech);
@@ -1485,6 +1516,8 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	if (!scan_ai->vidb)
 		goto out_ech;
 
+	scan_ai->hdrs_buf = alloc_hdrs_buf(ubi);
+
 	for (pnum = 0; pnum < UBI_FM_MAX_START; pnum++) {
 		dbg_gen("process PEB %d", pnum);
 		err = scan_peb(ubi, scan_ai, pnum, true);
@@ -1492,6 +1525,8 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 			goto out_vidh;
 	}
 
+	kfree(scan_ai->hdrs_buf);
+	scan_ai->hdrs_buf = NULL;
 	ubi_free_vid_buf(scan_ai->vidb);
 	kfree(scan_ai->ech);
 
@@ -1513,6 +1548,8 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 	return err;
 
 out_vidh:
+	kfree(scan_ai->hdrs_buf);
+	scan_ai->hdrs_buf = NULL;
 	ubi_free_vid_buf(scan_ai->vidb);
 out_ech:
 	kfree(scan_ai->ech);
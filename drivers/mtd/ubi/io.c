@@ -426,53 +426,13 @@ static int validate_ec_hdr(const struct ubi_device *ubi,
 	return 1;
 }
 
-/**
- * ubi_io_read_ec_hdr - read and check an erase counter header.
- * @ubi: UBI device description object
- * @pnum: physical eraseblock to read from
- * @ec_hdr: a &struct ubi_ec_hdr object where to store the read erase counter
- * header
- * @verbose: be verbose if the header is corrupted or was not found
- *
- * This function reads erase counter header from physical eraseblock @pnum and
- * stores it in @ec_hdr. This function also checks CRC checksum of the read
- * erase counter header. The following codes may be returned:
- *
- * o %0 if the CRC checksum is correct and the header was successfully read;
- * o %UBI_IO_BITFLIPS if the CRC is correct, but bit-flips were detected
- *   and corrected by the flash driver; this is harmless but may indicate that
- *   this eraseblock may become bad soon (but may be not);
- * o %UBI_IO_BAD_HDR if the erase counter header is corrupted (a CRC error);
- * o %UBI_IO_BAD_HDR_EBADMSG is the same as %UBI_IO_BAD_HDR, but there also was
- *   a data integrity error (uncorrectable ECC error in case of NAND);
- * o %UBI_IO_FF if only 0xFF bytes were read (the PEB is supposedly empty)
- * o a negative error code in case of failure.
- */
-int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
-		       struct ubi_ec_hdr *ec_hdr, int verbose)
+static int check_read_ec_hdr(struct ubi_device *ubi, int pnum,
+			     struct ubi_ec_hdr *ec_hdr, int read_err,
+			     int verbose)
 {
-	int err, read_err;
+	int err;
 	uint32_t crc, magic, hdr_crc;
 
-	dbg_io("read EC header from PEB %d", pnum);
-	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
-
-	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
-	if (read_err) {
-		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
-			return read_err;
-
-		/*
-		 * We read all the data, but either a correctable bit-flip
-		 * occurred, or MTD reported a data integrity error
-		 * (uncorrectable ECC error in case of NAND). The former is
-		 * harmless, the later may mean that the read data is
-		 * corrupted. But we have a CRC check-sum and we will detect
-		 * this. If the EC header is still OK, we just report this as
-		 * there was a bit-flip, to force scrubbing.
-		 */
-	}
-
 	magic = be32_to_cpu(ec_hdr->magic);
 	if (magic != UBI_EC_HDR_MAGIC) {
 		if (mtd_is_eccerr(read_err))
@@ -542,6 +502,55 @@ int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_ec_hdr - read and check an erase counter header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock to read from
+ * @ec_hdr: a &struct ubi_ec_hdr object where to store the read erase counter
+ * header
+ * @verbose: be verbose if the header is corrupted or was not found
+ *
+ * This function reads erase counter header from physical eraseblock @pnum and
+ * stores it in @ec_hdr. This function also checks CRC checksum of the read
+ * erase counter header. The following codes may be returned:
+ *
+ * o %0 if the CRC checksum is correct and the header was successfully read;
+ * o %UBI_IO_BITFLIPS if the CRC is correct, but bit-flips were detected
+ *   and corrected by the flash driver; this is harmless but may indicate that
+ *   this eraseblock may become bad soon (but may be not);
+ * o %UBI_IO_BAD_HDR if the erase counter header is corrupted (a CRC error);
+ * o %UBI_IO_BAD_HDR_EBADMSG is the same as %UBI_IO_BAD_HDR, but there also was
+ *   a data integrity error (uncorrectable ECC error in case of NAND);
+ * o %UBI_IO_FF if only 0xFF bytes were read (the PEB is supposedly empty)
+ * o a negative error code in case of failure.
+ */
+int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
+		       struct ubi_ec_hdr *ec_hdr, int verbose)
+{
+	int read_err;
+
+	dbg_io("read EC header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
+	if (read_err) {
+		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
+			return read_err;
+
+		/*
+		 * We read all the data, but either a correctable bit-flip
+		 * occurred, or MTD reported a data integrity error
+		 * (uncorrectable ECC error in case of NAND). The former is
+		 * harmless, the later may mean that the read data is
+		 * corrupted. But we have a CRC check-sum and we will detect
+		 * this. If the EC header is still OK, we just report this as
+		 * there was a bit-flip, to force scrubbing.
+		 */
+	}
+
+	return check_read_ec_hdr(ubi, pnum, ec_hdr, read_err, verbose);
+}
+
 /**
  * ubi_io_write_ec_hdr - write an erase counter header.
  * @ubi: UBI device description object
@@ -707,36 +716,13 @@ static int validate_vid_hdr(const struct ubi_device *ubi,
 	return 1;
 }
 
-/**
- * ubi_io_read_vid_hdr - read and check a volume identifier header.
- * @ubi: UBI device description object
- * @pnum: physical eraseblock number to read from
- * @vidb: the volume identifier buffer to store data in
- * @verbose: be verbose if the header is corrupted or wasn't found
- *
- * This function reads the volume identifier header from physical eraseblock
- * @pnum and stores it in @vidb. It also checks CRC checksum of the read
- * volume identifier header. The error codes are the same as in
- * 'ubi_io_read_ec_hdr()'.
- *
- * Note, the implementation of this function is also very similar to
- * 'ubi_io_read_ec_hdr()', so refer commentaries in 'ubi_io_read_ec_hdr()'.
- */
-int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
-			struct ubi_vid_io_buf *vidb, int verbose)
+static int check_read_vid_hdr(struct ubi_device *ubi, int pnum,
+			      struct ubi_vid_io_buf *vidb, int read_err,
+			      int verbose)
 {
-	int err, read_err;
+	int err;
 	uint32_t crc, magic, hdr_crc;
 	struct ubi_vid_hdr *vid_hdr = ubi_get_vid_hdr(vidb);
-	void *p = vidb->buffer;
-
-	dbg_io("read VID header from PEB %d", pnum);
-	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
-
-	read_err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
-			  ubi->vid_hdr_shift + UBI_VID_HDR_SIZE);
-	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
-		return read_err;
 
 	magic = be32_to_cpu(vid_hdr->magic);
 	if (magic != UBI_VID_HDR_MAGIC) {
@@ -791,6 +777,107 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_vid_hdr - read and check a volume identifier header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ * @vidb: the volume identifier buffer to store data in
+ * @verbose: be verbose if the header is corrupted or wasn't found
+ *
+ * This function reads the volume identifier header from physical eraseblock
+ * @pnum and stores it in @vidb. It also checks CRC checksum of the read
+ * volume identifier header. The error codes are the same as in
+ * 'ubi_io_read_ec_hdr()'.
+ *
+ * Note, the implementation of this function is also very similar to
+ * 'ubi_io_read_ec_hdr()', so refer commentaries in 'ubi_io_read_ec_hdr()'.
+ */
+int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_vid_io_buf *vidb, int verbose)
+{
+	int read_err;
+	void *p = vidb->buffer;
+
+	dbg_io("read VID header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
+
+	read_err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
+			  ubi->vid_hdr_shift + UBI_VID_HDR_SIZE);
+	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
+		return read_err;
+
+	return check_read_vid_hdr(ubi, pnum, vidb, read_err, verbose);
+}
+
+/**
+ * ubi_io_hdrs_len - size of the buffer needed by 'ubi_io_read_hdrs()'.
+ * @ubi: UBI device description object
+ *
+ * Returns the number of bytes from the start of a physical eraseblock up to
+ * and including the VID header, or %0 if the VID header is located too far
+ * away from the EC header to make reading both at once worthwhile.
+ */
+int ubi_io_hdrs_len(const struct ubi_device *ubi)
+{
+	if (ubi->vid_hdr_aloffset > ubi->min_io_size)
+		return 0;
+
+	return ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize;
+}
+
+/**
+ * ubi_io_read_hdrs - read and check both EC and VID header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock to read from
+ * @ec_hdr: a &struct ubi_ec_hdr object where to store the EC header
+ * @vidb: the volume identifier buffer to store the VID header in
+ * @buf: scratch buffer of 'ubi_io_hdrs_len()' bytes
+ * @vid_err: the result of checking the VID header is returned here
+ *
+ * This function is an optimization for scanning and is equivalent to calling
+ * 'ubi_io_read_ec_hdr()' followed by 'ubi_io_read_vid_hdr()' if the EC header
+ * is not empty. Both headers are read with a single flash read operation,
+ * which for NAND covers one page or two consecutive pages, so the flash
+ * driver can use sequential cache reads where supported.
+ *
+ * If the single read reports anything but success, the headers are read
+ * separately again, so that bit-flips and ECC errors are attributed to the
+ * right header.
+ *
+ * Returns the result of checking the EC header, see 'ubi_io_read_ec_hdr()'.
+ * @vid_err is only valid if the EC header is not empty.
+ */
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum,
+		     struct ubi_ec_hdr *ec_hdr, struct ubi_vid_io_buf *vidb,
+		     void *buf, int *vid_err)
+{
+	int err;
+
+	dbg_io("read EC and VID header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	err = ubi_io_read(ubi, buf, pnum, 0, ubi_io_hdrs_len(ubi));
+	if (err) {
+		err = ubi_io_read_ec_hdr(ubi, pnum, ec_hdr, 0);
+		if (err < 0 || err == UBI_IO_FF || err == UBI_IO_FF_BITFLIPS)
+			return err;
+
+		*vid_err = ubi_io_read_vid_hdr(ubi, pnum, vidb, 0);
+		return err;
+	}
+
+	memcpy(ec_hdr, buf, UBI_EC_HDR_SIZE);
+	err = check_read_ec_hdr(ubi, pnum, ec_hdr, 0, 0);
+	if (err < 0 || err == UBI_IO_FF || err == UBI_IO_FF_BITFLIPS)
+		return err;
+
+	memcpy(vidb->buffer, buf + ubi->vid_hdr_aloffset,
+	       ubi->vid_hdr_shift + UBI_VID_HDR_SIZE);
+	*vid_err = check_read_vid_hdr(ubi, pnum, vidb, 0, 0);
+
+	return err;
+}
+
 /**
  * ubi_io_write_vid_hdr - write a volume identifier header.
  * @ubi: UBI device description object
@@ -24,6 +24,34 @@
 #include <linux/err.h>
 
 static struct device_node *root_node;
+static unsigned long of_tree_generation;
+
+/**
+ * of_get_tree_generation - get the generation of the live device tree
+ *
+ * With CONFIG_OF_FIXUP_CACHE, the generation is incremented whenever the
+ * live device tree is modified, so it can be used to invalidate data derived
+ * from the live tree. Modifications through interfaces that don't know
+ * the node they operate on increment it for any tree.
+ */
+unsigned long of_get_tree_generation(void)
+{
+	return of_tree_generation;
+}
+
+static void of_node_changed(const struct device_node *np)
+{
+	if (!IS_ENABLED(CONFIG_OF_FIXUP_CACHE) || !root_node || !np)
+		return;
+
+	while (np->parent)
+		np = np->parent;
+
+	if (np == root_node)
+		of_tree_generation++;
+}
+
+static void __of_delete_property(struct property *pp);
 
 /**
  * of_node_has_prefix - Test if a node name has a given prefix
@@ -1412,8 +1440,10 @@ int of_property_write_bool(struct device_node *np, const char *propname,
 	struct property *prop = of_find_property(np, propname, NULL);
 
 	if (!value) {
-		if (prop)
-			of_delete_property(prop);
+		if (prop) {
+			__of_delete_property(prop);
+			of_node_changed(np);
+		}
 		return 0;
 	}
 
@@ -1447,7 +1477,7 @@ int of_property_write_u8_array(struct device_node *np,
 	struct property *prop = of_find_property(np, propname, NULL);
 
 	if (prop)
-		of_delete_property(prop);
+		__of_delete_property(prop);
 
 	prop = of_new_property(np, propname, values, sizeof(*values) * sz);
 	if (!prop)
@@ -1479,7 +1509,7 @@ int of_property_write_u16_array(struct device_node *np,
 	__be16 *val;
 
 	if (prop)
-		of_delete_property(prop);
+		__of_delete_property(prop);
 
 	prop = of_new_property(np, propname, NULL, sizeof(*val) * sz);
 	if (!prop)
@@ -1515,7 +1545,7 @@ int of_property_write_u32_array(struct device_node *np,
 	__be32 *val;
 
 	if (prop)
-		of_delete_property(prop);
+		__of_delete_property(prop);
 
 	prop = of_new_property(np, propname, NULL, sizeof(*val) * sz);
 	if (!prop)
@@ -1551,7 +1581,7 @@ int of_property_write_u64_array(struct device_node *np,
 	__be32 *val;
 
 	if (prop)
-		of_delete_property(prop);
+		__of_delete_property(prop);
 
 	prop = of_new_property(np, propname, NULL, 2 * sizeof(*val) * sz);
 	if (!prop)
@@ -1837,6 +1867,111 @@ int of_count_phandle_with_args(const struct device_node *np,
 }
 EXPORT_SYMBOL(of_count_phandle_with_args);
 
+static const struct {
+	const char *name;
+	const char *cells_name;
+} of_supplier_bindings[] = {
+	{ "clocks", "#clock-cells" },
+	{ "resets", "#reset-cells" },
+	{ "phys", "#phy-cells" },
+	{ "pwms", "#pwm-cells" },
+	{ "dmas", "#dma-cells" },
+	{ "power-domains", "#power-domain-cells" },
+	{ "mboxes", "#mbox-cells" },
+	{ "io-channels", "#io-channel-cells" },
+	{ "iommus", "#iommu-cells" },
+	{ "interrupts-extended", "#interrupt-cells" },
+	{ "gpios", "#gpio-cells" },
+	{ "interrupt-parent", NULL },
+	{ "nvmem-cells", NULL },
+};
+
+static void of_add_supplier(struct device_node ***suppliers, int *num,
+			    struct device_node *np)
+{
+	int i;
+
+	for (i = 0; i < *num; i++)
+		if ((*suppliers)[i] == np)
+			return;
+
+	*suppliers = xrealloc(*suppliers, (*num + 1) * sizeof(np));
+	(*suppliers)[(*num)++] = np;
+}
+
+static void of_add_suppliers(struct device_node ***suppliers, int *num,
+			     const struct device_node *np, const char *name,
+			     const char *cells_name)
+{
+	struct of_phandle_args args;
+	struct device_node *supplier;
+	int i, count;
+
+	if (!cells_name) {
+		for (i = 0; (supplier = of_parse_phandle(np, name, i)); i++)
+			of_add_supplier(suppliers, num, supplier);
+		return;
+	}
+
+	count = of_count_phandle_with_args(np, name, cells_name);
+	for (i = 0; i < count; i++) {
+		if (!of_parse_phandle_with_args(np, name, cells_name, i, &args))
+			of_add_supplier(suppliers, num, args.np);
+	}
+}
+
+/**
+ * of_get_suppliers - collect the nodes a device node depends on
+ * @np: the consumer node
+ * @suppliers: returns an allocated array of supplier nodes
+ *
+ * This looks at the well known bindings referring to resources provided by
+ * other devices (clocks, resets, regulators, GPIOs, pinctrl, ...) and returns
+ * the referenced nodes. Note that for some bindings (e.g. pinctrl states or
+ * nvmem cells) the node providing the resource is a parent of the returned
+ * node. The caller must free @suppliers.
+ *
+ * Return: the number of suppliers found
+ */
+int of_get_suppliers(const struct device_node *np,
+		     struct device_node ***suppliers)
+{
+	struct property *pp;
+	int i, num = 0;
+
+	*suppliers = NULL;
+
+	if (!np)
+		return 0;
+
+	list_for_each_entry(pp, &np->properties, list) {
+		const char *cells_name = NULL;
+
+		for (i = 0; i < ARRAY_SIZE(of_supplier_bindings); i++) {
+			if (!strcmp(pp->name, of_supplier_bindings[i].name))
+				break;
+		}
+
+		if (i < ARRAY_SIZE(of_supplier_bindings)) {
+			cells_name = of_supplier_bindings[i].cells_name;
+		} else if (strends(pp->name, "-gpios") ||
+			   strends(pp->name, "-gpio")) {
+			if (!strcmp(pp->name, "nr-gpios"))
+				continue;
+			cells_name = "#gpio-cells";
+		} else if (!strends(pp->name, "-supply") &&
+			   !(str_has_prefix(pp->name, "pinctrl-") &&
+			     isdigit(pp->name[8]))) {
+			continue;
+		}
+
+		of_add_suppliers(suppliers, &num, np, pp->name, cells_name);
+	}
+
+	return num;
+}
+EXPORT_SYMBOL(of_get_suppliers);
+
 /**
  * of_machine_is_compatible - Test root of device tree for a given compatible value
  * @compat: compatible string to look for in root node's compatible property.
@@ -1992,6 +2127,7 @@ int of_set_root_node(struct device_node *node)
 		return -EBUSY;
 
 	root_node = node;
+	of_tree_generation++;
 
 	of_chosen = of_find_node_by_path("/chosen");
 	of_property_read_string(root_node, "model", &of_model);
@@ -2489,8 +2625,22 @@ int of_diff(struct device_node *a, struct device_node *b, int indent)
 struct device_node *of_new_node(struct device_node *parent, const char *name)
 {
 	struct device_node *node;
+	size_t plen = 0, nlen = 0;
+
+	if (parent) {
+		plen = strlen(of_node_full_name(parent));
+		nlen = strlen(name);
+	}
+
+	/*
+	 * The full name is stored right behind the node and the name points
+	 * to its last path component, so creating a node costs a single
+	 * allocation. This matters when unflattening big device trees.
+	 */
+	of_node_changed(parent);
 
-	node = xzalloc(sizeof(*node));
+	node = xzalloc(sizeof(*node) + plen + 1 + nlen + 1);
+	node->full_name = (char *)(node + 1);
 	node->parent = parent;
 	if (parent)
 		list_add_tail(&node->parent_list, &parent->children);
@@ -2499,13 +2649,13 @@ struct device_node *of_new_node(struct device_node *parent, const char *name)
 	INIT_LIST_HEAD(&node->properties);
 
 	if (parent) {
-		node->name = xstrdup_const(name);
-		node->full_name = basprintf("%pOF/%s",
-					      node->parent, name);
+		memcpy(node->full_name, parent->full_name, plen);
+		node->full_name[plen] = '/';
+		memcpy(node->full_name + plen + 1, name, nlen + 1);
+		node->name = node->full_name + plen + 1;
 		list_add(&node->list, &parent->list);
 	} else {
-		node->name = xstrdup_const("");
-		node->full_name = xstrdup("");
+		node->name = node->full_name;
 		INIT_LIST_HEAD(&node->list);
 	}
 
@@ -2517,6 +2667,8 @@ struct property *__of_new_property(struct device_node *node, const char *name,
 {
 	struct property *prop;
 
+	of_node_changed(node);
+
 	prop = xzalloc(sizeof(*prop));
 	prop->name = xstrdup_const(name);
 	prop->length = len;
@@ -2570,6 +2722,8 @@ struct property *of_new_property_const(struct device_node *node, const char *nam
 {
 	struct property *prop;
 
+	of_node_changed(node);
+
 	prop = xzalloc(sizeof(*prop));
 	prop->name = xstrdup(name);
 	prop->length = len;
@@ -2580,18 +2734,98 @@ struct property *of_new_property_const(struct device_node *node, const char *nam
 	return prop;
 }
 
-void of_delete_property(struct property *pp)
+/**
+ * of_new_property_inline - Add a new property to a node
+ * @node:	device node to which the property is added
+ * @name:	Name of the new property
+ * @data:	Value of the property (can be NULL)
+ * @len:	Length of the value
+ *
+ * Same as of_new_property(), but the name and the value are stored in the
+ * same allocation as the property itself. This saves two allocations per
+ * property, which adds up when unflattening a device tree.
+ *
+ * Return: A pointer to the new property
+ */
+struct property *of_new_property_inline(struct device_node *node,
+					const char *name, const void *data,
+					int len)
+{
+	struct property *prop;
+	size_t vlen = ALIGN(len, sizeof(long));
+	char *buf;
+
+	of_node_changed(node);
+
+	prop = xzalloc(sizeof(*prop) + vlen + strlen(name) + 1);
+	buf = (char *)(prop + 1);
+
+	if (data)
+		memcpy(buf, data, len);
+	prop->value = buf;
+	prop->length = len;
+
+	prop->name = strcpy(buf + vlen, name);
+	prop->flags = OF_PROPERTY_INLINE_NAME | OF_PROPERTY_INLINE_VALUE;
+
+	list_add_tail(&prop->list, &node->properties);
+
+	return prop;
+}
+
+/**
+ * of_property_free_value - release the value of a property
+ * @pp:		the property
+ *
+ * Frees the value of @pp unless it's stored inline or not owned by the
+ * property. Afterwards the property has no value, the caller is expected
+ * to set a new one.
+ */
+void of_property_free_value(struct property *pp)
+{
+	of_tree_generation++;
+
+	if (!(pp->flags & OF_PROPERTY_INLINE_VALUE))
+		free(pp->value);
+
+	pp->flags &= ~OF_PROPERTY_INLINE_VALUE;
+	pp->value = NULL;
+	pp->value_const = NULL;
+}
+
+static void of_property_free_name(struct property *pp)
+{
+	if (!(pp->flags & OF_PROPERTY_INLINE_NAME))
+		free_const(pp->name);
+
+	pp->flags &= ~OF_PROPERTY_INLINE_NAME;
+	pp->name = NULL;
+}
+
+static void __of_delete_property(struct property *pp)
 {
 	if (!pp)
 		return;
 
 	list_del(&pp->list);
 
-	free_const(pp->name);
-	free(pp->value);
+	of_property_free_name(pp);
+	if (!(pp->flags & OF_PROPERTY_INLINE_VALUE))
+		free(pp->value);
 	free(pp);
 }
 
+void of_delete_property(struct property *pp)
+{
+	if (!pp)
+		return;
+
+	/* we don't know which tree the property belongs to */
+	of_tree_generation++;
+
+	__of_delete_property(pp);
+}
+
 struct property *of_rename_property(struct device_node *np,
 				    const char *old_name, const char *new_name)
 {
@@ -2603,7 +2837,8 @@ struct property *of_rename_property(struct device_node *np,
 
 	of_property_write_bool(np, new_name, false);
 
-	free_const(pp->name);
+	of_node_changed(np);
+	of_property_free_name(pp);
 	pp->name = xstrdup(new_name);
 	return pp;
 }
@@ -2646,7 +2881,7 @@ int of_set_property(struct device_node *np, const char *name, const void *val, i
 	if (!pp && !create)
 		return -ENOENT;
 
-	of_delete_property(pp);
+	__of_delete_property(pp);
 
 	pp = of_new_property(np, name, val, len);
 	if (!pp)
@@ -2670,10 +2905,22 @@ int of_append_property(struct device_node *np, const char *name, const void *val
 		return 0;
 	}
 
+	of_node_changed(np);
+
 	orig_len = pp->length;
-	buf = realloc(pp->value, orig_len + len);
-	if (!buf)
-		return -ENOMEM;
+
+	if (pp->flags & OF_PROPERTY_INLINE_VALUE) {
+		buf = malloc(orig_len + len);
+		if (!buf)
+			return -ENOMEM;
+
+		memcpy(buf, pp->value, orig_len);
+		pp->flags &= ~OF_PROPERTY_INLINE_VALUE;
+	} else {
+		buf = realloc(pp->value, orig_len + len);
+		if (!buf)
+			return -ENOMEM;
+	}
 
 	memcpy(buf + orig_len, val, len);
 
@@ -2710,10 +2957,14 @@ int of_prepend_property(struct device_node *np, const char *name, const void *va
 	memcpy(buf, val, len);
 	memcpy(buf + len, oldval, oldlen);
 
-	free(pp->value);
+	of_node_changed(np);
+
+	if (!(pp->flags & OF_PROPERTY_INLINE_VALUE))
+		free(pp->value);
+	pp->flags &= ~OF_PROPERTY_INLINE_VALUE;
+	pp->value_const = NULL;
 	pp->value = buf;
 	pp->length = len + oldlen;
-	pp->value_const = NULL;
 
 	return 0;
 }
@@ -2742,7 +2993,7 @@ int of_property_sprintf(struct device_node *np,
 	len++; /* trailing NUL */
 
 	pp = of_find_property(np, propname, NULL);
-	of_delete_property(pp);
+	__of_delete_property(pp);
 
 	__of_new_property(np, propname, buf, len);
 	return len;
@@ -2975,18 +3226,17 @@ void of_delete_node(struct device_node *node)
 	}
 
 	list_for_each_entry_safe(p, pt, &node->properties, list)
-		of_delete_property(p);
+		__of_delete_property(p);
 
 	list_for_each_entry_safe(n, nt, &node->children, parent_list)
 		of_delete_node(n);
 
 	if (node->parent) {
+		of_node_changed(node->parent);
 		list_del(&node->parent_list);
 		list_del(&node->list);
 	}
 
-	free_const(node->name);
-	free(node->full_name);
 	free(node);
 }
 
@@ -3085,12 +3335,12 @@ int of_add_initrd(struct device_node *root, resource_size_t start,
 		struct property *pp;
 
 		pp = of_find_property(chosen, "linux,initrd-start", NULL);
-		if (pp)
-			of_delete_property(pp);
+		__of_delete_property(pp);
 
 		pp = of_find_property(chosen, "linux,initrd-end", NULL);
-		if (pp)
-			of_delete_property(pp);
+		__of_delete_property(pp);
+
+		of_node_changed(chosen);
 	}
 
 	return 0;
@@ -3111,7 +3361,8 @@ int of_device_enable(struct device_node *node)
 	if (!pp)
 		return 0;
 
-	of_delete_property(pp);
+	__of_delete_property(pp);
+	of_node_changed(node);
 
 	return 0;
 }
@@ -280,7 +280,7 @@ static struct device_node *__of_unflatten_dtb(const void *infdt, int size,
 			if (constprops)
 				p = of_new_property_const(node, name, nodep, len);
 			else
-				p = of_new_property(node, name, nodep, len);
+				p = of_new_property_inline(node, name, nodep, len);
 
 			if (!strcmp(name, "phandle") && len == 4)
 				node->phandle = be32_to_cpup(of_property_get_value(p));
@@ -346,10 +346,8 @@ struct device_node *of_unflatten_dtb_const(const void *infdt, int size)
 struct fdt {
 	void *dt;
 	uint32_t dt_nextofs;
-	uint32_t dt_size;
 	char *strings;
 	uint32_t str_nextofs;
-	uint32_t str_size;
 };
 
 static inline uint32_t dt_next_ofs(uint32_t curofs, uint32_t len)
@@ -357,128 +355,83 @@ static inline uint32_t dt_next_ofs(uint32_t curofs, uint32_t len)
 	return ALIGN(curofs + len, 4);
 }
 
-static int lstrcpy(char *dest, const char *src)
-{
-	int len = 0;
-	int maxlen = 1023;
-
-	do {
-		*dest++ = *src;
-		len++;
-		if (!maxlen)
-			return -ENOSPC;
-		maxlen--;
-	} while (*src++);
-
-	return len - 1;
-}
+/*
+ * We assume strings and names have a maximum length of 1024
+ * whereas properties can be longer.
+ */
+#define FDT_MAX_NAME_LEN	1024
 
-static void *memalign_realloc(void *orig, size_t oldsize, size_t newsize)
+/*
+ * Calculate the exact size of the structure block and the strings block
+ * needed to flatten @node, so that the blob can be allocated in one go
+ * instead of growing it while flattening.
+ */
+static int of_flatten_dtb_size(struct device_node *node, size_t *dt_size,
+			       size_t *str_size)
 {
-	int align;
-	void *newbuf;
-
-	if (newsize > MALLOC_MAX_SIZE)
-		return NULL;
-
-	/*
-	 * ARM Linux uses a single 1MiB section (with 1MiB alignment)
-	 * for mapping the devicetree, so we are not allowed to cross
-	 * 1MiB boundaries. This got fixed in the Kernel since v3.8-rc5
-	 */
-	align = 1 << fls(newsize - 1);
-
-	if (!orig)
-		return memalign(align, newsize);
-
-	newbuf = memalign(align, newsize);
-	if (!newbuf) {
-		free(orig);
-		return NULL;
-	}
+	struct property *p;
+	struct device_node *n;
+	size_t len;
+	int ret;
 
-	memcpy(newbuf, orig, oldsize);
-	free(orig);
-	memset(newbuf + oldsize, 0, newsize - oldsize);
+	len = strnlen(node->name, FDT_MAX_NAME_LEN);
+	if (len == FDT_MAX_NAME_LEN)
+		return -ENOSPC;
 
-	return newbuf;
-}
+	*dt_size = dt_next_ofs(*dt_size, 4 + len + 1);
 
-static int fdt_ensure_space(struct fdt *fdt, int dtsize)
-{
-	size_t new_size;
-	void *previous;
+	list_for_each_entry(p, &node->properties, list) {
+		if (is_reserved_name(p->name))
+			continue;
 
-	/*
-	 * We assume strings and names have a maximum length of 1024
-	 * whereas properties can be longer. We allocate new memory
-	 * if we have less than 1024 bytes (+ the property size left.
-	 */
-	if (fdt->str_size - fdt->str_nextofs < 1024) {
-		previous = fdt->strings;
-		new_size = fdt->str_size * 2;
-
-		fdt->strings = realloc(previous, new_size);
-		if (!fdt->strings) {
-			free(previous);
-			return -ENOMEM;
-		}
+		len = strnlen(p->name, FDT_MAX_NAME_LEN);
+		if (len == FDT_MAX_NAME_LEN)
+			return -ENOSPC;
 
-		fdt->str_size = new_size;
+		*str_size += len + 1;
+		*dt_size = dt_next_ofs(*dt_size,
+				sizeof(struct fdt_property) + p->length);
 	}
 
-	if (fdt->dt_size - fdt->dt_nextofs < 1024 + dtsize) {
-		previous = fdt->dt;
-		new_size = fdt->dt_size * 2;
+	list_for_each_entry(n, &node->children, parent_list) {
+		if (is_reserved_name(n->name))
+			continue;
 
-		if (new_size <= dtsize)
-			new_size = roundup_pow_of_two(fdt->dt_size + dtsize);
+		ret = of_flatten_dtb_size(n, dt_size, str_size);
+		if (ret)
+			return ret;
+	}
 
-		fdt->dt = memalign_realloc(previous, fdt->dt_size, new_size);
-		if (!fdt->dt) {
-			free(previous);
-			return -ENOMEM;
-		}
+	*dt_size = dt_next_ofs(*dt_size, sizeof(struct fdt_node_header));
 
-		fdt->dt_size = new_size;
-	}
+	if (*dt_size > MALLOC_MAX_SIZE || *str_size > MALLOC_MAX_SIZE)
+		return -ENOMEM;
 
 	return 0;
 }
 
-static inline int dt_add_string(struct fdt *fdt, const char *str)
+static inline uint32_t dt_add_string(struct fdt *fdt, const char *str)
 {
-	uint32_t ret;
-	int len;
+	uint32_t ret = fdt->str_nextofs;
+	size_t len = strlen(str) + 1;
 
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
-
-	len = lstrcpy(fdt->strings + fdt->str_nextofs, str);
-	if (len < 0)
-		return -ENOSPC;
-
-	ret = fdt->str_nextofs;
-
-	fdt->str_nextofs += len + 1;
+	memcpy(fdt->strings + fdt->str_nextofs, str, len);
+	fdt->str_nextofs += len;
 
 	return ret;
 }
 
-static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node)
+static void __of_flatten_dtb(struct fdt *fdt, struct device_node *node)
 {
 	struct property *p;
 	struct device_node *n;
-	int ret;
 	unsigned int len;
 	struct fdt_node_header *nh;
 
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
-
 	nh = fdt->dt + fdt->dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_BEGIN_NODE);
-	len = lstrcpy(nh->name, node->name);
+	len = strlen(node->name);
+	memcpy(nh->name, node->name, len + 1);
 	fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs, 4 + len + 1);
 
 	list_for_each_entry(p, &node->properties, list) {
@@ -487,15 +440,13 @@ static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node)
 		if (is_reserved_name(p->name))
 			continue;
 
-		if (fdt_ensure_space(fdt, p->length) < 0)
-			return -ENOMEM;
-
 		fp = fdt->dt + fdt->dt_nextofs;
 
 		fp->tag = cpu_to_fdt32(FDT_PROP);
 		fp->len = cpu_to_fdt32(p->length);
 		fp->nameoff = cpu_to_fdt32(dt_add_string(fdt, p->name));
-		memcpy(fp->data, p->value, p->length);
+		if (p->length)
+			memcpy(fp->data, of_property_get_value(p), p->length);
 		fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs,
 				sizeof(struct fdt_property) + p->length);
 	}
@@ -504,20 +455,13 @@ static int __of_flatten_dtb(struct fdt *fdt, struct device_node *node)
 		if (is_reserved_name(n->name))
 			continue;
 
-		ret = __of_flatten_dtb(fdt, n);
-		if (ret)
-			return ret;
+		__of_flatten_dtb(fdt, n);
 	}
 
 	nh = fdt->dt + fdt->dt_nextofs;
 	nh->tag = cpu_to_fdt32(FDT_END_NODE);
 	fdt->dt_nextofs = dt_next_ofs(fdt->dt_nextofs,
 			sizeof(struct fdt_node_header));
-
-	if (fdt_ensure_space(fdt, 0) < 0)
-		return -ENOMEM;
-
-	return 0;
 }
 
 /**
@@ -532,31 +476,45 @@ void *of_flatten_dtb(struct device_node *node)
 	uint32_t ofs, off_mem_rsvmap;
 	struct fdt_node_header *nh;
 	struct device_node *memreserve;
+	size_t dt_size, str_size = 0, totalsize;
 	int len;
 
 	header.magic = cpu_to_fdt32(FDT_MAGIC);
 	header.version = cpu_to_fdt32(0x11);
 	header.last_comp_version = cpu_to_fdt32(0x10);
 
-	fdt.dt = xmemalign(SZ_64K, SZ_64K);
-	fdt.dt_size = SZ_64K;
-
-	fdt.strings = xzalloc(SZ_64K);
-	fdt.str_size = SZ_64K;
-
-	memset(fdt.dt, 0, SZ_64K);
-
 	ofs = sizeof(struct fdt_header);
 
 	off_mem_rsvmap = ofs;
 	header.off_mem_rsvmap = cpu_to_fdt32(off_mem_rsvmap);
 	ofs += sizeof(struct fdt_reserve_entry) * OF_MAX_RESERVE_MAP;
 
+	dt_size = ofs;
+	ret = of_flatten_dtb_size(node, &dt_size, &str_size);
+	if (ret)
+		return NULL;
+
+	/* FDT_END */
+	dt_size = dt_next_ofs(dt_size, sizeof(struct fdt_node_header));
+
+	totalsize = dt_size + str_size;
+	if (totalsize > MALLOC_MAX_SIZE)
+		return NULL;
+
+	/*
+	 * ARM Linux uses a single 1MiB section (with 1MiB alignment)
+	 * for mapping the devicetree, so we are not allowed to cross
+	 * 1MiB boundaries. This got fixed in the Kernel since v3.8-rc5
+	 */
+	fdt.dt = memalign(1 << fls(totalsize - 1), totalsize);
+	if (!fdt.dt)
+		return NULL;
+
+	memset(fdt.dt, 0, totalsize);
+	fdt.strings = fdt.dt + dt_size;
 	fdt.dt_nextofs = ofs;
 
-	ret = __of_flatten_dtb(&fdt, node);
-	if (ret)
-		goto out_free;
+	__of_flatten_dtb(&fdt, node);
 
 	memreserve = of_find_node_by_name_address(node, "$memreserve");
 	if (memreserve) {
@@ -576,28 +534,11 @@ void *of_flatten_dtb(struct device_node *node)
 	header.off_dt_strings = cpu_to_fdt32(fdt.dt_nextofs);
 	header.size_dt_strings = cpu_to_fdt32(fdt.str_nextofs);
 
-	if (fdt.dt_size - fdt.dt_nextofs < fdt.str_nextofs) {
-		fdt.dt = memalign_realloc(fdt.dt, fdt.dt_size,
-				fdt.dt_nextofs + fdt.str_nextofs);
-		if (!fdt.dt)
-			goto out_free;
-	}
-
-	memcpy(fdt.dt + fdt.dt_nextofs, fdt.strings, fdt.str_nextofs);
-
 	header.totalsize = cpu_to_fdt32(fdt.dt_nextofs + fdt.str_nextofs);
 
 	memcpy(fdt.dt, &header, sizeof(header));
 
-	free(fdt.strings);
-
 	return fdt.dt;
-
-out_free:
-	free(fdt.strings);
-	free(fdt.dt);
-
-	return NULL;
 }
 
 /*
@@ -18,8 +18,112 @@
 #include <fs.h>
 #include <libbb.h>
 #include <fnmatch.h>
+#include <linux/hash.h>
+
+/*
+ * Phandle index of the tree overlays are applied to. Looking up fragment
+ * targets by phandle and finding the highest phandle for renumbering the
+ * overlay would otherwise walk the whole tree each time. The index is
+ * built once and kept up to date while overlays are applied, so applying
+ * a batch of overlays only walks the target tree once.
+ */
+struct of_overlay_index {
+	struct device_node **nodes;
+	unsigned int bits;
+	unsigned int count;
+	phandle max_phandle;
+};
+
+static void of_overlay_index_insert(struct of_overlay_index *idx,
+				    struct device_node *np)
+{
+	unsigned int mask = (1U << idx->bits) - 1;
+	unsigned int i = hash_32(np->phandle, idx->bits);
+
+	while (idx->nodes[i]) {
+		if (idx->nodes[i]->phandle == np->phandle) {
+			idx->nodes[i] = np;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+
+	idx->nodes[i] = np;
+	idx->count++;
+}
+
+static void of_overlay_index_add(struct of_overlay_index *idx,
+				 struct device_node *np)
+{
+	struct device_node **old = idx->nodes;
+	unsigned int i, oldsize = 1U << idx->bits;
+
+	if (!np->phandle)
+		return;
+
+	idx->max_phandle = max(idx->max_phandle, np->phandle);
+
+	/* keep the load factor below 1/2 */
+	if (2 * (idx->count + 1) > oldsize) {
+		idx->bits++;
+		idx->nodes = xzalloc(sizeof(*idx->nodes) << idx->bits);
+		idx->count = 0;
+
+		for (i = 0; i < oldsize; i++)
+			if (old[i])
+				of_overlay_index_insert(idx, old[i]);
+
+		free(old);
+	}
+
+	of_overlay_index_insert(idx, np);
+}
+
+static struct device_node *of_overlay_index_find(struct of_overlay_index *idx,
+						 phandle phandle)
+{
+	unsigned int mask = (1U << idx->bits) - 1;
+	unsigned int i = hash_32(phandle, idx->bits);
+
+	while (idx->nodes[i]) {
+		if (idx->nodes[i]->phandle == phandle)
+			return idx->nodes[i];
+		i = (i + 1) & mask;
+	}
+
+	return NULL;
+}
+
+static void of_overlay_index_add_tree(struct of_overlay_index *idx,
+				      struct device_node *np)
+{
+	struct device_node *child;
+
+	of_overlay_index_add(idx, np);
+
+	for_each_child_of_node(np, child)
+		of_overlay_index_add_tree(idx, child);
+}
+
+static void of_overlay_index_init(struct of_overlay_index *idx,
+				  struct device_node *root)
+{
+	idx->bits = 6;
+	idx->count = 0;
+	idx->max_phandle = 0;
+	idx->nodes = xzalloc(sizeof(*idx->nodes) << idx->bits);
+
+	of_overlay_index_add_tree(idx, root);
+}
+
+static void of_overlay_index_free(struct of_overlay_index *idx)
+{
+	free(idx->nodes);
+	idx->nodes = NULL;
+}
 
 static struct device_node *find_target(struct device_node *root,
+				       struct of_overlay_index *idx,
 				       struct device_node *fragment)
 {
 	struct device_node *node;
@@ -29,7 +133,10 @@ static struct device_node *find_target(struct device_node *root,
 
 	ret = of_property_read_u32(fragment, "target", &phandle);
 	if (!ret) {
-		node = of_find_node_by_phandle_from(phandle, root);
+		if (idx)
+			node = of_overlay_index_find(idx, phandle);
+		else
+			node = of_find_node_by_phandle_from(phandle, root);
 		if (!node)
 			pr_err("fragment %pOF: phandle 0x%x not found\n",
 			       fragment, phandle);
@@ -50,7 +157,8 @@ static struct device_node *find_target(struct device_node *root,
 	return NULL;
 }
 
-static int of_overlay_apply(struct device_node *target,
+static int of_overlay_apply(struct of_overlay_index *idx,
+			    struct device_node *target,
 			    const struct device_node *overlay)
 {
 	struct device_node *child;
@@ -65,13 +173,15 @@ static int of_overlay_apply(struct device_node *target,
 		if (of_prop_cmp(prop->name, "name") == 0)
 			continue;
 
-		if (of_prop_cmp(prop->name, "phandle") == 0)
-			target->phandle = be32_to_cpup(prop->value);
-
 		err = of_set_property(target, prop->name, prop->value,
 				      prop->length, true);
 		if (err)
 			return err;
+
+		if (of_prop_cmp(prop->name, "phandle") == 0) {
+			target->phandle = be32_to_cpup(prop->value);
+			of_overlay_index_add(idx, target);
+		}
 	}
 
 	for_each_child_of_node(overlay, child) {
@@ -81,7 +191,7 @@ static int of_overlay_apply(struct device_node *target,
 		if (!target_child)
 			return -ENOMEM;
 
-		err = of_overlay_apply(target_child, child);
+		err = of_overlay_apply(idx, target_child, child);
 		if (err)
 			return err;
 	}
@@ -90,6 +200,7 @@ static int of_overlay_apply(struct device_node *target,
 }
 
 static char *of_overlay_fix_path(struct device_node *root,
+				 struct of_overlay_index *idx,
 				 struct device_node *overlay, const char *path)
 {
 	struct device_node *fragment;
@@ -107,7 +218,7 @@ static char *of_overlay_fix_path(struct device_node *root,
 		return NULL;
 	}
 
-	target = find_target(root, fragment);
+	target = find_target(root, idx, fragment);
 	if (!target)
 		return NULL;
 
@@ -118,6 +229,7 @@ static char *of_overlay_fix_path(struct device_node *root,
 }
 
 static int of_overlay_apply_symbols(struct device_node *root,
+				    struct of_overlay_index *idx,
 				    struct device_node *overlay)
 {
 	const char *old_path;
@@ -144,7 +256,7 @@ static int of_overlay_apply_symbols(struct device_node *root,
 			continue;
 
 		old_path = of_property_get_value(prop);
-		new_path = of_overlay_fix_path(root, overlay, old_path);
+		new_path = of_overlay_fix_path(root, idx, overlay, old_path);
 		if (!new_path)
 			return -EINVAL;
 
@@ -158,6 +270,7 @@ static int of_overlay_apply_symbols(struct device_node *root,
 }
 
 static int of_overlay_apply_fragment(struct device_node *root,
+				     struct of_overlay_index *idx,
 				     struct device_node *fragment)
 {
 	struct device_node *target;
@@ -167,28 +280,24 @@ static int of_overlay_apply_fragment(struct device_node *root,
 	if (!overlay)
 		return 0;
 
-	target = find_target(root, fragment);
+	target = find_target(root, idx, fragment);
 	if (!target)
 		return -EINVAL;
 
-	return of_overlay_apply(target, overlay);
+	return of_overlay_apply(idx, target, overlay);
 }
 
 static char *of_overlay_compatible;
 
-/**
- * Apply the overlay on the passed devicetree root
- * @root: the devicetree onto which the overlay will be applied
- * @overlay: the devicetree to apply as an overlay
- */
-int of_overlay_apply_tree(struct device_node *root,
-			  struct device_node *overlay)
+static int __of_overlay_apply_tree(struct device_node *root,
+				   struct of_overlay_index *idx,
+				   struct device_node *overlay)
 {
 	struct device_node *resolved;
 	struct device_node *fragment;
 	int err = 0;
 
-	resolved = of_resolve_phandles(root, overlay);
+	resolved = __of_resolve_phandles(root, overlay, &idx->max_phandle);
 	if (!resolved)
 		return -EINVAL;
 
@@ -197,24 +306,42 @@ int of_overlay_apply_tree(struct device_node *root,
 		goto out_err;
 
 	/* Copy symbols from resolved overlay to base device tree */
-	err = of_overlay_apply_symbols(root, resolved);
+	err = of_overlay_apply_symbols(root, idx, resolved);
 	if (err)
 		goto out_err;
 
 	/* Copy nodes and properties from resolved overlay to root */
 	for_each_child_of_node(resolved, fragment) {
-		err = of_overlay_apply_fragment(root, fragment);
+		err = of_overlay_apply_fragment(root, idx, fragment);
 		if (err)
 			pr_warn("failed to apply %s\n", fragment->name);
 	}
 
+out_err:
+	of_delete_node(resolved);
+
+	return err;
+}
+
+/**
+ * Apply the overlay on the passed devicetree root
+ * @root: the devicetree onto which the overlay will be applied
+ * @overlay: the devicetree to apply as an overlay
+ */
+int of_overlay_apply_tree(struct device_node *root,
+			  struct device_node *overlay)
+{
+	struct of_overlay_index idx;
+	int err;
+
+	of_overlay_index_init(&idx, root);
+	err = __of_overlay_apply_tree(root, &idx, overlay);
+	of_overlay_index_free(&idx);
+
 	/* We are patching the live tree, reload aliases */
 	if (root == of_get_root_node())
 		of_alias_scan();
 
-out_err:
-	of_delete_node(resolved);
-
 	return err;
 }
 
@@ -306,8 +433,9 @@ static bool of_overlay_matches_filter(const char *filename, struct device_node *
 	return apply;
 }
 
-int of_overlay_apply_file(struct device_node *root, const char *filename,
-			  bool filter)
+static int __of_overlay_apply_file(struct device_node *root,
+				   struct of_overlay_index *idx,
+				   const char *filename, bool filter)
 {
 	struct device_node *ovl;
 	int ret;
@@ -322,7 +450,7 @@ int of_overlay_apply_file(struct device_node *root, const char *filename,
 	if (filter && !of_overlay_matches_filter(NULL, ovl))
 		return 0;
 
-	ret = of_overlay_apply_tree(root, ovl);
+	ret = __of_overlay_apply_tree(root, idx, ovl);
 	if (ret == -ENODEV)
 		pr_debug("Not applied %s (not compatible)\n", filename);
 	else if (ret)
@@ -335,6 +463,23 @@ int of_overlay_apply_file(struct device_node *root, const char *filename,
 	return ret;
 }
 
+int of_overlay_apply_file(struct device_node *root, const char *filename,
+			  bool filter)
+{
+	struct of_overlay_index idx;
+	int ret;
+
+	of_overlay_index_init(&idx, root);
+	ret = __of_overlay_apply_file(root, &idx, filename, filter);
+	of_overlay_index_free(&idx);
+
+	/* We are patching the live tree, reload aliases */
+	if (root == of_get_root_node())
+		of_alias_scan();
+
+	return ret;
+}
+
 int of_overlay_apply_dtbo(struct device_node *root, const void *dtbo)
 {
 	struct device_node *overlay;
@@ -377,7 +522,7 @@ int of_process_overlay(struct device_node *root,
 		if (!ovl)
 			continue;
 
-		target = find_target(root, fragment);
+		target = find_target(root, NULL, fragment);
 		if (!target)
 			pr_debug("cannot find target for fragment %s\n",
 				 fragment->name);
@@ -428,6 +573,7 @@ void of_overlay_set_basedir(const char *path)
 static int of_overlay_apply_dir(struct device_node *root, const char *dirname,
 				bool filter)
 {
+	struct of_overlay_index idx;
 	int ret = 0;
 	DIR *dir;
 
@@ -440,6 +586,8 @@ static int of_overlay_apply_dir(struct device_node *root, const char *dirname,
 	if (!dir)
 		return -errno;
 
+	of_overlay_index_init(&idx, root);
+
 	while (1) {
 		struct dirent *ent;
 		char *filename;
@@ -453,13 +601,17 @@ static int of_overlay_apply_dir(struct device_node *root, const char *dirname,
 
 		filename = basprintf("%s/%s", dirname, dir->d.d_name);
 
-		of_overlay_apply_file(root, filename, filter);
+		__of_overlay_apply_file(root, &idx, filename, filter);
 
 		free(filename);
 	}
 
+	of_overlay_index_free(&idx);
 	closedir(dir);
 
+	if (root == of_get_root_node())
+		of_alias_scan();
+
 	return ret;
 }
 
@@ -14,14 +14,19 @@
 
 /**
  * Recursively update phandles in overlay by adding delta
+ *
+ * Returns the highest phandle in the overlay after the update.
  */
-static void adjust_overlay_phandles(struct device_node *overlay, int delta)
+static phandle adjust_overlay_phandles(struct device_node *overlay, int delta)
 {
 	struct device_node *child;
 	struct property *prop;
+	phandle max = 0;
 
-	if (overlay->phandle != 0)
+	if (overlay->phandle != 0) {
 		overlay->phandle += delta;
+		max = overlay->phandle;
+	}
 
 	list_for_each_entry(prop, &overlay->properties, list) {
 		if (of_prop_cmp(prop->name, "phandle") != 0 &&
@@ -34,7 +39,9 @@ static void adjust_overlay_phandles(struct device_node *overlay, int delta)
 	}
 
 	for_each_child_of_node(overlay, child)
-		adjust_overlay_phandles(child, delta);
+		max = max_t(phandle, max, adjust_overlay_phandles(child, delta));
+
+	return max;
 }
 
 /**
@@ -174,18 +181,19 @@ static int adjust_local_phandle_references(struct device_node *local_fixups,
 }
 
 /**
- * of_resolve_phandles - Resolve phandles in overlay based on root
- *
- * Rename phandles in overlay to avoid conflicts with the base devicetree and
- * replace all phandles in the overlay with their renamed versions. Resolve
- * phandles referring to nodes in the base devicetree with the phandle from
- * the base devicetree.
+ * __of_resolve_phandles - Resolve phandles in overlay based on root
+ * @root: the base devicetree
+ * @overlay: the overlay to resolve
+ * @max_phandle: highest phandle in use in @root
  *
- * Returns a new device_node with resolved phandles which must be deleted by
- * the caller of this function.
+ * Like of_resolve_phandles(), but the caller passes the highest phandle of
+ * @root instead of having the whole tree walked to find it. On success
+ * @max_phandle is updated to the highest phandle of the resolved overlay,
+ * so that several overlays can be resolved against the same tree.
  */
-struct device_node *of_resolve_phandles(struct device_node *root,
-					const struct device_node *overlay)
+struct device_node *__of_resolve_phandles(struct device_node *root,
+					  const struct device_node *overlay,
+					  phandle *max_phandle)
 {
 	struct device_node *result;
 	struct device_node *local_fixups;
@@ -194,20 +202,20 @@ struct device_node *of_resolve_phandles(struct device_node *root,
 	struct device_node *overlay_fixups;
 	struct property *prop;
 	const char *refpath;
-	phandle delta;
+	phandle delta, max;
 	int err;
 
 	result = of_copy_node(NULL, overlay);
 	if (!result)
 		return NULL;
 
-	delta = of_get_tree_max_phandle(root) + 1;
+	delta = *max_phandle + 1;
 
 	/*
 	 * Rename the phandles in the devicetree overlay to prevent conflicts
 	 * with the phandles in the base devicetree.
 	 */
-	adjust_overlay_phandles(result, delta);
+	max = adjust_overlay_phandles(result, delta);
 
 	/*
 	 * __local_fixups__ contains all locations in the overlay that refer
@@ -268,6 +276,8 @@ struct device_node *of_resolve_phandles(struct device_node *root,
 	}
 
 out:
+	*max_phandle = max_t(phandle, *max_phandle, max);
+
 	return result;
 err:
 	of_delete_node(result);
@@ -275,3 +285,22 @@ struct device_node *of_resolve_phandles(struct device_node *root,
 	return NULL;
 
 }
+
+/**
+ * of_resolve_phandles - Resolve phandles in overlay based on root
+ *
+ * Rename phandles in overlay to avoid conflicts with the base devicetree and
+ * replace all phandles in the overlay with their renamed versions. Resolve
+ * phandles referring to nodes in the base devicetree with the phandle from
+ * the base devicetree.
+ *
+ * Returns a new device_node with resolved phandles which must be deleted by
+ * the caller of this function.
+ */
+struct device_node *of_resolve_phandles(struct device_node *root,
+					const struct device_node *overlay)
+{
+	phandle max = of_get_tree_max_phandle(root);
+
+	return __of_resolve_phandles(root, overlay, &max);
+}
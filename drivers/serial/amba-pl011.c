@@ -115,6 +115,13 @@ static void pl011_putc(struct console_device *cdev, char c)
 	writel(c, uart->base + UART01x_DR);
 }
 
+static int pl011_tx_ready(struct console_device *cdev)
+{
+	struct amba_uart_port *uart = to_amba_uart_port(cdev);
+
+	return !(readl(uart->base + UART01x_FR) & UART01x_FR_TXFF);
+}
+
 static int pl011_getc(struct console_device *cdev)
 {
 	struct amba_uart_port *uart = to_amba_uart_port(cdev);
@@ -199,6 +206,7 @@ static int pl011_probe(struct amba_device *dev, const struct amba_id *id)
 	cdev->dev = &dev->dev;
 	cdev->tstc = pl011_tstc;
 	cdev->putc = pl011_putc;
+	cdev->tx_ready = pl011_tx_ready;
 	cdev->getc = pl011_getc;
 	cdev->setbrg = uart->clk ? pl011_setbaudrate : NULL;
 	cdev->linux_console_name = "ttyAMA";
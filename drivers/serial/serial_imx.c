@@ -129,6 +129,14 @@ static void imx_serial_putc(struct console_device *cdev, char c)
         writel(c, priv->regs + URTX0);
 }
 
+static int imx_serial_tx_ready(struct console_device *cdev)
+{
+	struct imx_serial_priv *priv = container_of(cdev,
+					struct imx_serial_priv, cdev);
+
+	return !(readl(priv->regs + priv->devtype->uts) & UTS_TXFULL);
+}
+
 static int imx_serial_tstc(struct console_device *cdev)
 {
 	struct imx_serial_priv *priv = container_of(cdev,
@@ -230,6 +238,7 @@ static int imx_serial_probe(struct device *dev)
 	cdev->dev = dev;
 	cdev->tstc = imx_serial_tstc;
 	cdev->putc = imx_serial_putc;
+	cdev->tx_ready = imx_serial_tx_ready;
 	cdev->getc = imx_serial_getc;
 	cdev->flush = imx_serial_flush;
 	cdev->setbrg = priv->clk ? imx_serial_setbaudrate : NULL;
@@ -302,6 +302,18 @@ static void ns16550_putc(struct console_device *cdev, char c)
 	}
 }
 
+/**
+ * @brief Test if a character can be put without waiting
+ *
+ * @param[in] cdev pointer to console device
+ *
+ * @return  - status based on transmitter state
+ */
+static int ns16550_tx_ready(struct console_device *cdev)
+{
+	return (ns16550_read(cdev, lsr) & LSR_THRE) == LSR_THRE;
+}
+
 /**
  * @brief Retrieve a character from serial port
  *
@@ -551,6 +563,8 @@ static int ns16550_probe(struct device *dev)
 	cdev->getc = ns16550_getc;
 	cdev->setbrg = priv->plat.clock ? ns16550_setbaudrate : NULL;
 	cdev->flush = ns16550_flush;
+	if (!priv->rs485_mode)
+		cdev->tx_ready = ns16550_tx_ready;
 	cdev->linux_console_name = devtype->linux_console_name;
 	cdev->linux_earlycon_name = basprintf("%s,%s", devtype->linux_earlycon_name,
 					      priv->access_type);
@@ -116,7 +116,15 @@ enum dfu_state {
 #define USB_DT_DFU_SIZE			9
 #define USB_DT_DFU			0x21
 
-#define CONFIG_USBD_DFU_XFER_SIZE     4096
+/*
+ * Blocks are received back to back into the write buffers, so the transfer
+ * size must keep each of them aligned for DMA.
+ */
+#define DFU_XFER_SIZE	ALIGN_DOWN(CONFIG_USB_GADGET_DFU_XFER_SIZE, ARCH_DMA_MINALIGN)
+#define DFU_BUF_SIZE	(16 * DFU_XFER_SIZE)
+#define DFU_NUM_BUFS	2
+/* poll interval reported while all buffers are waiting to be written */
+#define DFU_BUSY_POLL_MS	2
 #define DFU_TEMPFILE "/dfu_temp"
 
 struct file_list_entry *dfu_file_entry;
@@ -134,10 +142,23 @@ static struct usb_dfu_func_descriptor usb_dfu_func = {
 	.bDescriptorType	= USB_DT_DFU,
 	.bmAttributes		= USB_DFU_CAN_UPLOAD | USB_DFU_CAN_DOWNLOAD | USB_DFU_MANIFEST_TOL,
 	.wDetachTimeOut		= 0xff00,
-	.wTransferSize		= CONFIG_USBD_DFU_XFER_SIZE,
+	.wTransferSize		= DFU_XFER_SIZE,
 	.bcdDFUVersion		= 0x0100,
 };
 
+/*
+ * Downloaded blocks are received directly into one of these buffers, which
+ * is handed over to the work queue for writing once it is full. The work
+ * queue runs synchronously, so this batches writes rather than overlapping
+ * them with reception. The second buffer only takes the next blocks until
+ * the work queue gets to run.
+ */
+struct dfu_buf {
+	void *data;
+	size_t fill;
+	bool busy;
+};
+
 struct f_dfu {
 	struct usb_function		func;
 	u8				port_num;
@@ -145,6 +166,9 @@ struct f_dfu {
 	u8	dfu_state;
 	u8	dfu_status;
 	struct usb_request		*dnreq;
+	void				*xfer_buf;
+	struct dfu_buf			bufs[DFU_NUM_BUFS];
+	struct dfu_buf			*cur;
 	struct work_queue wq;
 };
 
@@ -175,9 +199,32 @@ struct dfu_work {
 	void (*task)(struct dfu_work *dw);
 	size_t len;
 	uint8_t *rbuf;
-	uint8_t wbuf[CONFIG_USBD_DFU_XFER_SIZE];
+	struct dfu_buf *buf;
 };
 
+static void dfu_release_buf(struct dfu_buf *buf)
+{
+	buf->fill = 0;
+	buf->busy = false;
+}
+
+static struct dfu_buf *dfu_get_buf(struct f_dfu *dfu)
+{
+	int i;
+
+	if (dfu->cur)
+		return dfu->cur;
+
+	for (i = 0; i < DFU_NUM_BUFS; i++) {
+		if (!dfu->bufs[i].busy) {
+			dfu->cur = &dfu->bufs[i];
+			break;
+		}
+	}
+
+	return dfu->cur;
+}
+
 static void dfu_do_work(struct work_struct *w)
 {
 	struct dfu_work *dw = container_of(w, struct dfu_work, work);
@@ -188,6 +235,9 @@ static void dfu_do_work(struct work_struct *w)
 	else
 		pr_debug("skip work\n");
 
+	if (dw->buf)
+		dfu_release_buf(dw->buf);
+
 	free(dw);
 }
 
@@ -195,6 +245,9 @@ static void dfu_work_cancel(struct work_struct *w)
 {
 	struct dfu_work *dw = container_of(w, struct dfu_work, work);
 
+	if (dw->buf)
+		dfu_release_buf(dw->buf);
+
 	free(dw);
 }
 
@@ -219,7 +272,7 @@ static void dfu_do_write(struct dfu_work *dw)
 	}
 
 	dfu_written += wlen;
-	ret = write(dfufd, dw->wbuf, wlen);
+	ret = write(dfufd, dw->buf->data, wlen);
 	if (ret < wlen) {
 		perror("write");
 		dfu->dfu_state = DFU_STATE_dfuERROR;
@@ -396,10 +449,17 @@ dfu_bind(struct usb_configuration *c, struct usb_function *f)
 		status = -ENOMEM;
 		goto out;
 	}
-	dfu->dnreq->buf = dma_alloc(CONFIG_USBD_DFU_XFER_SIZE);
+	dfu->xfer_buf = dma_alloc(DFU_XFER_SIZE);
+	dfu->dnreq->buf = dfu->xfer_buf;
 	dfu->dnreq->complete = dn_complete;
 	dfu->dnreq->zero = 0;
 
+	for (i = 0; i < DFU_NUM_BUFS; i++) {
+		dfu->bufs[i].data = dma_alloc(DFU_BUF_SIZE);
+		dfu_release_buf(&dfu->bufs[i]);
+	}
+	dfu->cur = &dfu->bufs[0];
+
 	us = usb_gstrings_attach(cdev, dfu_strings, n_entries + 1);
 	if (IS_ERR(us)) {
 		status = PTR_ERR(us);
@@ -459,6 +519,7 @@ static void
 dfu_unbind(struct usb_configuration *c, struct usb_function *f)
 {
 	struct f_dfu		*dfu = func_to_dfu(f);
+	int i;
 
 	dfu_files = NULL;
 	dfu_file_entry = NULL;
@@ -468,7 +529,10 @@ dfu_unbind(struct usb_configuration *c, struct usb_function *f)
 
 	usb_free_all_descriptors(f);
 
-	dma_free(dfu->dnreq->buf);
+	for (i = 0; i < DFU_NUM_BUFS; i++)
+		dma_free(dfu->bufs[i].data);
+
+	dma_free(dfu->xfer_buf);
 	usb_ep_free_request(c->cdev->gadget->ep0, dfu->dnreq);
 }
 
@@ -517,15 +581,30 @@ static int dfu_status(struct usb_function *f, const struct usb_ctrlrequest *ctrl
 	dstat->bwPollTimeout[1] = 0;
 	dstat->bwPollTimeout[2] = 0;
 
+	/*
+	 * Let the host wait for the next block while no buffer is available
+	 * for receiving it.
+	 */
+	if (dfu->dfu_state == DFU_STATE_dfuDNLOAD_IDLE && !dfu_get_buf(dfu)) {
+		dstat->bState = DFU_STATE_dfuDNBUSY;
+		dstat->bwPollTimeout[0] = DFU_BUSY_POLL_MS;
+	}
+
 	return sizeof(*dstat);
 }
 
 static void dfu_cleanup(struct f_dfu *dfu)
 {
 	struct dfu_work *dw;
+	int i;
 
 	pr_debug("dfu cleanup\n");
 
+	for (i = 0; i < DFU_NUM_BUFS; i++)
+		if (!dfu->bufs[i].busy)
+			dfu_release_buf(&dfu->bufs[i]);
+	dfu->cur = NULL;
+
 	memset(&dfu_mtdinfo, 0, sizeof(dfu_mtdinfo));
 	dfu_written = 0;
 	dfu_erased = 0;
@@ -540,17 +619,47 @@ static void dfu_cleanup(struct f_dfu *dfu)
 	wq_queue_work(&dfu->wq, &dw->work);
 }
 
-static void dn_complete(struct usb_ep *ep, struct usb_request *req)
+/* hand the current buffer over to the work queue for writing */
+static void dfu_submit_buf(struct f_dfu *dfu)
 {
-	struct f_dfu		*dfu = req->context;
+	struct dfu_buf *buf = dfu->cur;
 	struct dfu_work *dw;
 
+	if (!buf || !buf->fill)
+		return;
+
+	buf->busy = true;
+	dfu->cur = NULL;
+
 	dw = xzalloc(sizeof(*dw));
 	dw->dfu = dfu;
 	dw->task = dfu_do_write;
-	dw->len = min_t(unsigned int, req->length, CONFIG_USBD_DFU_XFER_SIZE);
-	memcpy(dw->wbuf, req->buf, dw->len);
+	dw->buf = buf;
+	dw->len = buf->fill;
 	wq_queue_work(&dfu->wq, &dw->work);
+
+	dfu_get_buf(dfu);
+}
+
+static void dn_complete(struct usb_ep *ep, struct usb_request *req)
+{
+	struct f_dfu		*dfu = req->context;
+	struct dfu_buf		*buf = dfu->cur;
+
+	req->buf = dfu->xfer_buf;
+
+	if (!buf)
+		return;
+
+	buf->fill += min_t(unsigned int, req->length, DFU_XFER_SIZE);
+
+	/*
+	 * Submit on short blocks as well, so that following blocks are always
+	 * received at a transfer size aligned offset.
+	 */
+	if (req->length < DFU_XFER_SIZE ||
+	    buf->fill + DFU_XFER_SIZE > DFU_BUF_SIZE)
+		dfu_submit_buf(dfu);
 }
 
 static int handle_manifest(struct usb_function *f, const struct usb_ctrlrequest *ctrl)
@@ -558,6 +667,8 @@ static int handle_manifest(struct usb_function *f, const struct usb_ctrlrequest
 	struct f_dfu		*dfu = func_to_dfu(f);
 	struct dfu_work *dw;
 
+	dfu_submit_buf(dfu);
+
 	if (dfu_file_entry->flags & FILE_LIST_FLAG_SAFE) {
 		dw = xzalloc(sizeof(*dw));
 		dw->dfu = dfu;
@@ -578,6 +689,7 @@ static int handle_dnload(struct usb_function *f, const struct usb_ctrlrequest *c
 	struct f_dfu		*dfu = func_to_dfu(f);
 	struct usb_composite_dev *cdev = f->config->cdev;
 	u16			w_length = le16_to_cpu(ctrl->wLength);
+	struct dfu_buf		*buf;
 
 	if (w_length == 0) {
 		handle_manifest(f, ctrl);
@@ -585,6 +697,15 @@ static int handle_dnload(struct usb_function *f, const struct usb_ctrlrequest *c
 		return 0;
 	}
 
+	buf = dfu_get_buf(dfu);
+	if (!buf || w_length > DFU_XFER_SIZE) {
+		/* host did not wait for dfuDNLOAD_IDLE or ignored wTransferSize */
+		dfu->dfu_state = DFU_STATE_dfuERROR;
+		dfu->dfu_status = DFU_STATUS_errSTALLEDPKT;
+		return -EINVAL;
+	}
+
+	dfu->dnreq->buf = buf->data + buf->fill;
 	dfu->dnreq->length = w_length;
 	dfu->dnreq->context = dfu;
 	usb_ep_queue(cdev->gadget->ep0, dfu->dnreq);
@@ -602,6 +723,8 @@ static int handle_upload(struct usb_function *f, const struct usb_ctrlrequest *c
 	struct dfu_work *dw;
 	u16			w_length = le16_to_cpu(ctrl->wLength);
 
+	dfu->dnreq->buf = dfu->xfer_buf;
+
 	dw = xzalloc(sizeof(*dw));
 	dw->dfu = dfu;
 	dw->task = dfu_do_read;
@@ -660,6 +783,8 @@ static int dfu_setup(struct usb_function *f, const struct usb_ctrlrequest *ctrl)
 			wq_queue_work(&dfu->wq, &dw->work);
 
 			value = handle_dnload(f, ctrl);
+			if (value)
+				break;
 			dfu->dfu_state = DFU_STATE_dfuDNLOAD_IDLE;
 			return 0;
 		case USB_REQ_DFU_UPLOAD:
@@ -36,9 +36,9 @@ typedef enum {
 int assign_drives (int, int);
 DSTATUS disk_initialize (FATFS *fatfs);
 DSTATUS disk_status (FATFS *fatfs);
-DRESULT disk_read (FATFS *fatfs, BYTE*, DWORD, BYTE);
+DRESULT disk_read (FATFS *fatfs, BYTE*, DWORD, UINT);
 #if	_READONLY == 0
-DRESULT disk_write (FATFS *fatfs, const BYTE*, DWORD, BYTE);
+DRESULT disk_write (FATFS *fatfs, const BYTE*, DWORD, UINT);
 #endif
 DRESULT disk_ioctl (FATFS *fatfs, BYTE, void*);
 
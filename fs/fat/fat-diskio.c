@@ -21,11 +21,6 @@ DWORD get_fattime(void)
 	return 0;
 }
 
-DRESULT disk_ioctl (FATFS *fat, BYTE command, void *buf)
-{
-	return 0;
-}
-
 WCHAR ff_convert(WCHAR src, UINT dir)
 {
 	if (src <= 0x80)
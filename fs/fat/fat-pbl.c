@@ -13,12 +13,17 @@
 #include "ff.h"
 #include "diskio.h"
 
-DRESULT disk_read(FATFS *fat, BYTE *buf, DWORD sector, BYTE count)
+DRESULT disk_read(FATFS *fat, BYTE *buf, DWORD sector, UINT count)
 {
 	int ret = pbl_bio_read(fat->userdata, sector, buf, count);
 	return ret != count ? ret : 0;
 }
 
+DRESULT disk_ioctl(FATFS *fat, BYTE command, void *buf)
+{
+	return 0;
+}
+
 ssize_t pbl_fat_load(struct pbl_bio *bio, const char *filename, void *dest, size_t len)
 {
 	FATFS	fs = {};
@@ -25,6 +25,7 @@
 #include <linux/ctype.h>
 #include <xfuncs.h>
 #include <fcntl.h>
+#include <block.h>
 #include "ff.h"
 #include "integer.h"
 #include "diskio.h"
@@ -36,35 +37,52 @@ struct fat_priv {
 
 /* ---------------------------------------------------------------*/
 
-DRESULT disk_read(FATFS *fat, BYTE *buf, DWORD sector, BYTE count)
+DRESULT disk_read(FATFS *fat, BYTE *buf, DWORD sector, UINT count)
 {
 	struct fat_priv *priv = fat->userdata;
-	int ret;
+	size_t size = (size_t)count * fat->ssize;
+	ssize_t ret;
 
 	debug("%s: sector: %ld count: %d\n", __func__, sector, count);
 
-	ret = cdev_read(priv->cdev, buf, count << 9, (loff_t)sector * 512, 0);
-	if (ret != count << 9)
+	ret = cdev_read(priv->cdev, buf, size, (loff_t)sector * fat->ssize, 0);
+	if (ret != size)
 		return ret;
 
 	return 0;
 }
 
-DRESULT disk_write(FATFS *fat, const BYTE *buf, DWORD sector, BYTE count)
+DRESULT disk_write(FATFS *fat, const BYTE *buf, DWORD sector, UINT count)
 {
 	struct fat_priv *priv = fat->userdata;
-	int ret;
+	size_t size = (size_t)count * fat->ssize;
+	ssize_t ret;
 
 	debug("%s: buf: %p sector: %ld count: %d\n",
 			__func__, buf, sector, count);
 
-	ret = cdev_write(priv->cdev, buf, count << 9, (loff_t)sector * 512, 0);
-	if (ret != count << 9)
+	ret = cdev_write(priv->cdev, buf, size, (loff_t)sector * fat->ssize, 0);
+	if (ret != size)
 		return ret;
 
 	return 0;
 }
 
+DRESULT disk_ioctl(FATFS *fat, BYTE command, void *buf)
+{
+	struct fat_priv *priv = fat->userdata;
+	struct block_device *blk;
+
+	switch (command) {
+	case GET_SECTOR_SIZE:
+		blk = cdev_get_block_device(priv->cdev);
+		*(WORD *)buf = blk ? BLOCKSIZE(blk) : 512;
+		break;
+	}
+
+	return 0;
+}
+
 /* ---------------------------------------------------------------*/
 
 #ifdef CONFIG_FS_FAT_WRITE
@@ -367,6 +367,89 @@ static DWORD get_fat (	/* 0xFFFFFFFF:Disk error, 1:Internal error, Else:Cluster
 	return 0xFFFFFFFF;	/* An error occurred at the disk I/O layer */
 }
 
+#if _USE_FASTSEEK
+/*
+ * Create the cluster link map of a file
+ *
+ * The map holds the cluster chain as runs of contiguous clusters, stored as
+ * {number of clusters, first cluster} pairs and terminated by a zero. It is
+ * only created for files not opened for writing, as their chain can't change.
+ */
+static void clmt_create (
+	FIL *fp		/* Pointer to the file object */
+)
+{
+	FATFS *fs = fp->fs;
+	DWORD *tbl = NULL, *ntbl;
+	DWORD cl, pcl, ncl, left, bcs;
+	UINT n = 0, size = 0;
+
+	if (fp->cltbl || fp->no_cltbl || (fp->flag & FA_WRITE) ||
+	    !fp->sclust || !fp->fsize)
+		return;
+
+	bcs = (DWORD)fs->csize * SS(fs);
+	left = fp->fsize / bcs + !!(fp->fsize % bcs);	/* Number of clusters of the file */
+	cl = fp->sclust;
+
+	while (left) {
+		ncl = 0;
+		do {				/* Follow a run of contiguous clusters */
+			pcl = cl;
+			ncl++;
+			if (!--left)
+				break;
+			cl = get_fat(fs, cl);
+			if (cl <= 1 || cl >= fs->n_fatent)
+				goto err;	/* Disk error or broken chain */
+		} while (cl == pcl + 1);
+
+		if (n + 3 > size) {		/* Room for this run and the terminator */
+			size = size ? size * 2 : 16;
+			ntbl = realloc(tbl, size * sizeof(DWORD));
+			if (!ntbl)
+				goto err;
+			tbl = ntbl;
+		}
+		tbl[n++] = ncl;
+		tbl[n++] = pcl - ncl + 1;
+	}
+
+	tbl[n] = 0;
+	fp->cltbl = tbl;
+	return;
+err:
+	free(tbl);
+	fp->no_cltbl = 1;	/* Keep following the chain on the FAT */
+}
+
+/*
+ * Get the cluster containing a file offset from the cluster link map
+ */
+static DWORD clmt_clust (	/* 0:Offset not in the map, >=2:Cluster# */
+	FIL *fp,	/* Pointer to the file object */
+	DWORD ofs,	/* File offset */
+	DWORD *nfollow	/* Returns number of contiguous clusters following it (may be NULL) */
+)
+{
+	DWORD cl, ncl, *tbl = fp->cltbl;
+
+	cl = ofs / SS(fp->fs) / fp->fs->csize;	/* Cluster order from top of the file */
+	for (;;) {
+		ncl = *tbl++;
+		if (!ncl)
+			return 0;	/* End of table */
+		if (cl < ncl)
+			break;		/* In this run */
+		cl -= ncl;
+		tbl++;
+	}
+	if (nfollow)
+		*nfollow = ncl - cl - 1;
+
+	return cl + *tbl;
+}
+#endif
 
 
 
@@ -1561,6 +1644,9 @@ static int chk_mounted (	/* 0(0): successful, !=0: any error occurred */
 	DWORD first_boot_sect;
 	DWORD bsect, fasize, tsect, sysect, nclst, szbfat;
 	WORD nrsv;
+#if _MAX_SS != 512
+	WORD ss;
+#endif
 	enum filetype type;
 
 	INIT_LIST_HEAD(&fs->dirtylist);
@@ -1587,9 +1673,31 @@ static int chk_mounted (	/* 0(0): successful, !=0: any error occurred */
 
 	/* Following code initializes the file system object */
 
+#if _MAX_SS != 512
+	/*
+	 * The medium is accessed byte-wise, so the logical sector size of the
+	 * volume may differ from the physical one. bsect is in physical
+	 * sectors and has to be converted. A bigger logical sector size
+	 * requires the volume to be aligned to it.
+	 */
+	ss = LD_WORD(fs->win+BPB_BytsPerSec);
+	if (ss != SS(fs)) {
+		if (ss < 512 || ss > _MAX_SS || (ss & (ss - 1)))
+			return -EINVAL;
+		if (ss > SS(fs)) {
+			if (bsect % (ss / SS(fs)))
+				return -EINVAL;
+			bsect /= ss / SS(fs);
+		} else {
+			bsect *= SS(fs) / ss;
+		}
+		fs->ssize = ss;
+	}
+#else
 	/* (BPB_BytsPerSec must be equal to the physical sector size) */
 	if (LD_WORD(fs->win+BPB_BytsPerSec) != SS(fs))
 		return -EINVAL;
+#endif
 
 	/* Number of sectors per FAT */
 	fmt = FS_FAT12;
@@ -1812,6 +1920,10 @@ int f_open (
 		fp->fsize = LD_DWORD(dir+DIR_FileSize);	/* File size */
 		fp->fptr = 0;			/* File pointer */
 		fp->dsect = 0;
+#if _USE_FASTSEEK
+		fp->cltbl = NULL;		/* Cluster link map is created on demand */
+		fp->no_cltbl = 0;
+#endif
 		fp->fs = dj.fs;
 	}
 
@@ -1832,8 +1944,11 @@ int f_read (
 )
 {
 	DWORD clst, sect, remain;
-	UINT rcnt, cc;
+	UINT rcnt, cc, mcc;
 	BYTE csect, *rbuff = buff;
+#if _USE_FASTSEEK
+	DWORD nfollow;
+#endif
 
 	*br = 0;	/* Initialize byte counter */
 
@@ -1853,6 +1968,12 @@ int f_read (
 				if (fp->fptr == 0) {		/* On the top of the file? */
 					clst = fp->sclust;	/* Follow from the origin */
 				} else {			/* Middle or end of the file */
+#if _USE_FASTSEEK
+					clmt_create(fp);
+					if (fp->cltbl)		/* Look it up in the cluster link map */
+						clst = clmt_clust(fp, fp->fptr, NULL);
+					else
+#endif
 						clst = get_fat(fp->fs, fp->clust);	/* Follow cluster chain on the FAT */
 				}
 				if (clst < 2)
@@ -1867,10 +1988,21 @@ int f_read (
 			sect += csect;
 			cc = btr / SS(fp->fs);		/* When remaining bytes >= sector size, */
 			if (cc) {			/* Read maximum contiguous sectors directly */
-				if (csect + cc > fp->fs->csize)	/* Clip at cluster boundary */
-					cc = fp->fs->csize - csect;
-				if (disk_read(fp->fs, rbuff, sect, (BYTE)cc) != RES_OK)
+				mcc = fp->fs->csize - csect;	/* Sectors left in the cluster */
+#if _USE_FASTSEEK
+				if (cc > mcc) {		/* Extend over the following contiguous clusters */
+					clmt_create(fp);
+					if (fp->cltbl && clmt_clust(fp, fp->fptr, &nfollow))
+						mcc += min_t(DWORD, nfollow, (cc - mcc) / fp->fs->csize + 1) *
+							fp->fs->csize;
+				}
+#endif
+				if (cc > mcc)		/* Clip at cluster boundary */
+					cc = mcc;
+				if (disk_read(fp->fs, rbuff, sect, cc) != RES_OK)
 					ABORT(fp->fs, -EIO);
+				/* Move to the last cluster the read went into */
+				fp->clust += (csect + cc - 1) / fp->fs->csize;
 #if defined FS_FAT_WRITE
 				/* Replace one of the read sectors with cached data if it contains a dirty sector */
 				if ((fp->flag & FA__DIRTY) && fp->dsect - sect < cc)
@@ -1971,7 +2103,7 @@ int f_write (
 				/* Write maximum contiguous sectors directly */
 				if (csect + cc > fp->fs->csize)	/* Clip at cluster boundary */
 					cc = fp->fs->csize - csect;
-				if (disk_write(fp->fs, wbuff, sect, (BYTE)cc) != RES_OK)
+				if (disk_write(fp->fs, wbuff, sect, cc) != RES_OK)
 					ABORT(fp->fs, -EIO);
 				if (fp->dsect - sect < cc) {
 					/* Refill sector cache if it gets invalidated by the direct write */
@@ -2054,18 +2186,20 @@ int f_close (
 	FIL *fp		/* Pointer to the file object to be closed */
 )
 {
-#ifndef FS_FAT_WRITE
-	fp->fs = 0;	/* Discard file object */
-	return 0;
-#else
+#ifdef FS_FAT_WRITE
 	int res;
 
 	/* Flush cached data */
 	res = f_sync(fp);
-	if (res == 0)
-		fp->fs = NULL;	/* Discard file object */
-	return res;
+	if (res)
+		return res;
+#endif
+#if _USE_FASTSEEK
+	free(fp->cltbl);	/* Discard cluster link map */
+	fp->cltbl = NULL;
 #endif
+	fp->fs = NULL;	/* Discard file object */
+	return 0;
 }
 
 /*
@@ -2088,6 +2222,32 @@ int f_lseek (
 #endif
 		) ofs = fp->fsize;
 
+#if _USE_FASTSEEK
+	if (ofs)
+		clmt_create(fp);
+	if (fp->cltbl) {	/* Fast seek using the cluster link map */
+		fp->fptr = ofs;
+		if (!ofs)
+			return 0;
+		clst = clmt_clust(fp, ofs - 1, NULL);
+		if (!clst)
+			ABORT(fp->fs, -ERESTARTSYS);
+		fp->clust = clst;
+		if (ofs % SS(fp->fs)) {
+			nsect = clust2sect(fp->fs, clst);	/* Current sector */
+			if (!nsect)
+				ABORT(fp->fs, -ERESTARTSYS);
+			nsect += (ofs - 1) / SS(fp->fs) & (fp->fs->csize - 1);
+			if (nsect != fp->dsect) {	/* Fill sector cache if needed */
+				if (disk_read(fp->fs, fp->buf, nsect, 1) != RES_OK)
+					ABORT(fp->fs, -EIO);
+				fp->dsect = nsect;
+			}
+		}
+		return 0;
+	}
+#endif
+
 	ifptr = fp->fptr;
 	fp->fptr = nsect = 0;
 	if (ofs) {
@@ -110,6 +110,7 @@ typedef struct {
 #endif
 #if _USE_FASTSEEK
 	DWORD*	cltbl;		/* Pointer to the cluster link map table (null on file open) */
+	BYTE	no_cltbl;	/* Cluster link map could not be created */
 #endif
 #if _FS_SHARE
 	UINT	lockid;		/* File lock ID (index of file semaphore table) */
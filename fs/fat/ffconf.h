@@ -33,8 +33,14 @@
 /* To enable f_forward function, set _USE_FORWARD to 1 and set _FS_TINY to 1. */
 
 
+#ifdef __PBL__
 #define	_USE_FASTSEEK	0	/* 0:Disable or 1:Enable */
-/* To enable fast seek feature, set _USE_FASTSEEK to 1. */
+#else
+#define	_USE_FASTSEEK	1
+#endif
+/* To enable fast seek feature, set _USE_FASTSEEK to 1.
+/  In barebox the cluster link map is allocated and built by FatFs itself on
+/  first use for files opened read-only. */
 
 
 
@@ -103,12 +109,18 @@
 /* Number of volumes (logical drives) to be used. */
 
 
+#ifdef __PBL__
 #define	_MAX_SS		512		/* 512, 1024, 2048 or 4096 */
+#else
+#define	_MAX_SS		4096
+#endif
 /* Maximum sector size to be handled.
 /  Always set 512 for memory card and hard disk but a larger value may be
 /  required for on-board flash memory, floppy disk and optical disk.
 /  When _MAX_SS is larger than 512, it configures FatFs to variable sector size
-/  and GET_SECTOR_SIZE command must be implememted to the disk_ioctl function. */
+/  and GET_SECTOR_SIZE command must be implememted to the disk_ioctl function.
+/  In barebox the volume may use a larger logical sector size than the
+/  device, as the medium is accessed byte-wise. */
 
 #define	_USE_ERASE	0	/* 0:Disable or 1:Enable */
 /* To enable sector erase feature, set _USE_ERASE to 1. CTRL_ERASE_SECTOR command
@@ -121,6 +121,7 @@ struct jffs2_sb_info {
 	uint32_t wbuf_pagesize; /* 0 for NOR and other flashes with no wbuf */
 
 	struct jffs2_summary *summary;		/* Summary information */
+	uint32_t summary_blocks;		/* Eraseblocks scanned via their summary */
 	struct jffs2_mount_opts mount_opts;
 
 #ifdef CONFIG_JFFS2_FS_XATTR
@@ -9,8 +9,10 @@
 
 #define pr_fmt(fmt) "jffs2: " fmt
 #include <common.h>
+#include <clock.h>
 #include <crc.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/sched.h>
 #include <linux/mtd/mtd.h>
 #include <linux/pagemap.h>
@@ -87,6 +89,7 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 	uint32_t buf_size = 0;
 	struct jffs2_summary *s = NULL; /* summary info collected by the scan process */
 	size_t try_size;
+	u64 start = get_time_ns();
 
 	if (!flashbuf) {
 		/* For NAND it's quicker to read a whole eraseblock at a time,
@@ -234,6 +237,12 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 			goto out;
 		}
 	}
+
+	if (jffs2_sum_active())
+		pr_info("scanned %u eraseblocks (%u via summary) in %llu ms\n",
+			c->nr_blocks, c->summary_blocks,
+			div_u64(get_time_ns() - start, MSECOND));
+
 	ret = 0;
  out:
 	if (buf_size)
@@ -478,6 +487,8 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 			   If it returns positive, that's a block classification
 			   (i.e. BLK_STATE_xxx) so return that too.
 			   If it returns zero, fall through to full scan. */
+			if (err > 0)
+				c->summary_blocks++;
 			if (err)
 				return err;
 		}
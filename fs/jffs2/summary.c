@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * JFFS2 -- Journalling Flash File System, Version 2.
+ *
+ * Copyright © 2004  Ferenc Havasi <havasi@inf.u-szeged.hu>,
+ *		     Zoltan Sogor <weth@inf.u-szeged.hu>,
+ *		     Patrik Kluba <pajko@halom.u-szeged.hu>,
+ *		     University of Szeged, Hungary
+ *	       2006  KaiGai Kohei <kaigai@ak.jp.nec.com>
+ *
+ * Read-only part of the erase block summary support: use the summary nodes
+ * written by Linux to avoid scanning every node of an eraseblock.
+ */
+
+#define pr_fmt(fmt) "jffs2: " fmt
+
+#include <common.h>
+#include <crc.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/mtd/mtd.h>
+#include <linux/pagemap.h>
+#include "nodelist.h"
+#include "summary.h"
+#include "debug.h"
+
+/* Returned by jffs2_sum_process_sum_data() to request a full scan */
+#define JFFS2_SUM_FULL_SCAN	1
+
+static struct jffs2_raw_node_ref *sum_link_node_ref(struct jffs2_sb_info *c,
+						    struct jffs2_eraseblock *jeb,
+						    uint32_t ofs, uint32_t len,
+						    struct jffs2_inode_cache *ic)
+{
+	/* If there was a gap, mark it dirty */
+	if ((ofs & ~3) > c->sector_size - jeb->free_size) {
+		/* Ew. Summary doesn't actually tell us explicitly about dirty space */
+		jffs2_scan_dirty_space(c, jeb, (ofs & ~3) - (c->sector_size - jeb->free_size));
+	}
+
+	return jffs2_link_node_ref(c, jeb, jeb->offset + ofs, len, ic);
+}
+
+static void jffs2_sum_reset_jeb(struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb)
+{
+	c->wasted_size -= jeb->wasted_size;
+	c->free_size += c->sector_size - jeb->free_size;
+	c->used_size -= jeb->used_size;
+	c->dirty_size -= jeb->dirty_size;
+	jeb->wasted_size = jeb->used_size = jeb->dirty_size = 0;
+	jeb->free_size = c->sector_size;
+
+	jffs2_free_jeb_node_refs(c, jeb);
+}
+
+/* Process the stored summary information - helper function for jffs2_sum_scan_sumnode() */
+
+static int jffs2_sum_process_sum_data(struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb,
+				      struct jffs2_raw_summary *summary, uint32_t sumsize,
+				      uint32_t *pseudo_random)
+{
+	struct jffs2_inode_cache *ic;
+	struct jffs2_full_dirent *fd;
+	void *sp, *end;
+	int i, ino;
+	int err;
+
+	sp = summary->sum;
+	end = (void *)summary + sumsize;
+
+	for (i = 0; i < je32_to_cpu(summary->sum_num); i++) {
+		uint16_t nodetype;
+
+		dbg_summary("processing summary index %d\n", i);
+
+		cond_resched();
+
+		if (sp + sizeof(struct jffs2_sum_unknown_flash) > end)
+			goto corrupt;
+
+		/* Make sure there's a spare ref for dirty space */
+		err = jffs2_prealloc_raw_node_refs(c, jeb, 2);
+		if (err)
+			return err;
+
+		nodetype = je16_to_cpu(((struct jffs2_sum_unknown_flash *)sp)->nodetype);
+
+		switch (nodetype) {
+		case JFFS2_NODETYPE_INODE: {
+			struct jffs2_sum_inode_flash *spi = sp;
+
+			if (sp + JFFS2_SUMMARY_INODE_SIZE > end)
+				goto corrupt;
+
+			ino = je32_to_cpu(spi->inode);
+
+			dbg_summary("Inode at 0x%08x-0x%08x\n",
+				    jeb->offset + je32_to_cpu(spi->offset),
+				    jeb->offset + je32_to_cpu(spi->offset) + je32_to_cpu(spi->totlen));
+
+			ic = jffs2_scan_make_ino_cache(c, ino);
+			if (!ic) {
+				JFFS2_NOTICE("scan_make_ino_cache failed\n");
+				return -ENOMEM;
+			}
+
+			sum_link_node_ref(c, jeb, je32_to_cpu(spi->offset) | REF_UNCHECKED,
+					  PAD(je32_to_cpu(spi->totlen)), ic);
+
+			*pseudo_random += je32_to_cpu(spi->version);
+
+			sp += JFFS2_SUMMARY_INODE_SIZE;
+
+			break;
+		}
+
+		case JFFS2_NODETYPE_DIRENT: {
+			struct jffs2_sum_dirent_flash *spd = sp;
+			int checkedlen;
+
+			if (sp + JFFS2_SUMMARY_DIRENT_SIZE(0) > end ||
+			    sp + JFFS2_SUMMARY_DIRENT_SIZE(spd->nsize) > end)
+				goto corrupt;
+
+			dbg_summary("Dirent at 0x%08x-0x%08x\n",
+				    jeb->offset + je32_to_cpu(spd->offset),
+				    jeb->offset + je32_to_cpu(spd->offset) + je32_to_cpu(spd->totlen));
+
+			/* This should never happen, but https://dev.laptop.org/ticket/4184 */
+			checkedlen = strnlen(spd->name, spd->nsize);
+			if (!checkedlen) {
+				pr_err("Dirent at %08x has zero at start of name. Aborting mount.\n",
+				       jeb->offset + je32_to_cpu(spd->offset));
+				return -EIO;
+			}
+			if (checkedlen < spd->nsize) {
+				pr_err("Dirent at %08x has zeroes in name. Truncating to %d chars\n",
+				       jeb->offset + je32_to_cpu(spd->offset),
+				       checkedlen);
+			}
+
+			fd = jffs2_alloc_full_dirent(checkedlen+1);
+			if (!fd)
+				return -ENOMEM;
+
+			memcpy(&fd->name, spd->name, checkedlen);
+			fd->name[checkedlen] = 0;
+
+			ic = jffs2_scan_make_ino_cache(c, je32_to_cpu(spd->pino));
+			if (!ic) {
+				jffs2_free_full_dirent(fd);
+				return -ENOMEM;
+			}
+
+			fd->raw = sum_link_node_ref(c, jeb, je32_to_cpu(spd->offset) | REF_UNCHECKED,
+						    PAD(je32_to_cpu(spd->totlen)), ic);
+
+			fd->next = NULL;
+			fd->version = je32_to_cpu(spd->version);
+			fd->ino = je32_to_cpu(spd->ino);
+			fd->nhash = full_name_hash(NULL, fd->name, checkedlen);
+			fd->type = spd->type;
+
+			jffs2_add_fd_to_list(c, fd, &ic->scan_dents);
+
+			*pseudo_random += je32_to_cpu(spd->version);
+
+			sp += JFFS2_SUMMARY_DIRENT_SIZE(spd->nsize);
+
+			break;
+		}
+
+		default:
+			JFFS2_WARNING("Unsupported node type %x found in summary! Exiting...\n",
+				      nodetype);
+			if ((nodetype & JFFS2_COMPAT_MASK) == JFFS2_FEATURE_INCOMPAT)
+				return -EIO;
+
+			/*
+			 * Incompatible types, which include xattr and xref
+			 * nodes, fail the mount just like the full scan would.
+			 * For unknown compatible types fall back to the full
+			 * scan, which knows how to handle them.
+			 */
+			jffs2_sum_reset_jeb(c, jeb);
+			return JFFS2_SUM_FULL_SCAN;
+		}
+	}
+
+	return 0;
+
+corrupt:
+	JFFS2_WARNING("Summary of eraseblock at 0x%08x exceeds summary node, doing full scan\n",
+		      jeb->offset);
+	jffs2_sum_reset_jeb(c, jeb);
+
+	return JFFS2_SUM_FULL_SCAN;
+}
+
+/**
+ * jffs2_sum_scan_sumnode - process the summary node of an eraseblock
+ * @c: the JFFS2 filesystem
+ * @jeb: the eraseblock
+ * @summary: the summary node read from the end of @jeb
+ * @sumsize: size of the summary node
+ * @pseudo_random: seed updated with the node versions
+ *
+ * Called from jffs2_scan_eraseblock().
+ *
+ * Return: the BLK_STATE_xxx classification of @jeb if the summary was used,
+ * 0 if the eraseblock must be scanned fully, or a negative error code.
+ */
+int jffs2_sum_scan_sumnode(struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb,
+			   struct jffs2_raw_summary *summary, uint32_t sumsize,
+			   uint32_t *pseudo_random)
+{
+	struct jffs2_unknown_node crcnode;
+	int ret, ofs;
+	uint32_t crc;
+
+	if (sumsize < sizeof(struct jffs2_raw_summary))
+		goto crc_err;
+
+	ofs = c->sector_size - sumsize;
+
+	dbg_summary("summary found for 0x%08x at 0x%08x (0x%x bytes)\n",
+		    jeb->offset, jeb->offset + ofs, sumsize);
+
+	/* OK, now check for node validity and CRC */
+	crcnode.magic = cpu_to_je16(JFFS2_MAGIC_BITMASK);
+	crcnode.nodetype = cpu_to_je16(JFFS2_NODETYPE_SUMMARY);
+	crcnode.totlen = summary->totlen;
+	crc = crc32(0, &crcnode, sizeof(crcnode)-4);
+
+	if (je32_to_cpu(summary->hdr_crc) != crc) {
+		dbg_summary("Summary node header is corrupt (bad CRC or "
+				"no summary at all)\n");
+		goto crc_err;
+	}
+
+	if (je32_to_cpu(summary->totlen) != sumsize) {
+		dbg_summary("Summary node is corrupt (wrong erasesize?)\n");
+		goto crc_err;
+	}
+
+	crc = crc32(0, summary, sizeof(struct jffs2_raw_summary)-8);
+
+	if (je32_to_cpu(summary->node_crc) != crc) {
+		dbg_summary("Summary node is corrupt (bad CRC)\n");
+		goto crc_err;
+	}
+
+	crc = crc32(0, summary->sum, sumsize - sizeof(struct jffs2_raw_summary));
+
+	if (je32_to_cpu(summary->sum_crc) != crc) {
+		dbg_summary("Summary node data is corrupt (bad CRC)\n");
+		goto crc_err;
+	}
+
+	if (je32_to_cpu(summary->cln_mkr)) {
+
+		dbg_summary("Summary : CLEANMARKER node\n");
+
+		ret = jffs2_prealloc_raw_node_refs(c, jeb, 1);
+		if (ret)
+			return ret;
+
+		if (je32_to_cpu(summary->cln_mkr) != c->cleanmarker_size) {
+			dbg_summary("CLEANMARKER node has totlen 0x%x != normal 0x%x\n",
+				je32_to_cpu(summary->cln_mkr), c->cleanmarker_size);
+			if ((ret = jffs2_scan_dirty_space(c, jeb, PAD(je32_to_cpu(summary->cln_mkr)))))
+				return ret;
+		} else if (jeb->first_node) {
+			dbg_summary("CLEANMARKER node not first node in block "
+					"(0x%08x)\n", jeb->offset);
+			if ((ret = jffs2_scan_dirty_space(c, jeb, PAD(je32_to_cpu(summary->cln_mkr)))))
+				return ret;
+		} else {
+			jffs2_link_node_ref(c, jeb, jeb->offset | REF_NORMAL,
+					    je32_to_cpu(summary->cln_mkr), NULL);
+		}
+	}
+
+	ret = jffs2_sum_process_sum_data(c, jeb, summary, sumsize, pseudo_random);
+	/* JFFS2_SUM_FULL_SCAN isn't an error -- it means we should do a full
+	   scan of this eraseblock. So return zero */
+	if (ret == JFFS2_SUM_FULL_SCAN)
+		return 0;
+	if (ret)
+		return ret;		/* real error */
+
+	/* for PARANOIA_CHECK */
+	ret = jffs2_prealloc_raw_node_refs(c, jeb, 2);
+	if (ret)
+		return ret;
+
+	sum_link_node_ref(c, jeb, ofs | REF_NORMAL, sumsize, NULL);
+
+	if (unlikely(jeb->free_size)) {
+		JFFS2_WARNING("Free size 0x%x bytes in eraseblock @0x%08x with summary?\n",
+			      jeb->free_size, jeb->offset);
+		jeb->wasted_size += jeb->free_size;
+		c->wasted_size += jeb->free_size;
+		c->free_size -= jeb->free_size;
+		jeb->free_size = 0;
+	}
+
+	return jffs2_scan_classify_jeb(c, jeb);
+
+crc_err:
+	JFFS2_WARNING("Summary node crc error, skipping summary information.\n");
+
+	return 0;
+}
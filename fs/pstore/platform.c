@@ -71,14 +71,14 @@ void pstore_log(const char *str)
 static void pstore_console_capture_log(void)
 {
 	uint64_t id;
-	struct log_entry *log, *tmp;
+	struct log_entry *log;
 
 	if (IS_ENABLED(CONFIG_CONSOLE_NONE))
 		return;
 
-	list_for_each_entry_safe(log, tmp, &barebox_logbuf, list) {
+	for_each_log_entry(log) {
 		psinfo->write_buf(PSTORE_TYPE_CONSOLE, 0, &id, 0,
-				  log->msg, 0, strlen(log->msg), psinfo);
+				  log->msg, 0, log->msg_len, psinfo);
 	}
 }
 
@@ -96,6 +96,13 @@ static struct inode *ramfs_get_inode(struct super_block *sb, const struct inode
 
 #define MIN_SIZE SZ_8K
 
+/*
+ * Files grow geometrically so that a file written sequentially in small
+ * pieces ends up in a logarithmic number of chunks. The growth step is
+ * limited to keep the amount of overallocated memory bounded.
+ */
+#define MAX_GROW_SIZE SZ_16M
+
 static struct ramfs_chunk *ramfs_get_chunk(unsigned long size)
 {
 	struct ramfs_chunk *data;
@@ -293,10 +300,27 @@ static int ramfs_truncate_up(struct ramfs_inode *node, unsigned long size)
 	unsigned long add = size - node->alloc_size;
 	unsigned long chunksize = add;
 	unsigned long alloc_size = 0;
+	unsigned long grow;
 
 	if (node->alloc_size >= size)
 		return 0;
 
+	/*
+	 * Allocate some more space than requested when the file grows
+	 * beyond its current allocation. This is only a hint, if it fails
+	 * we go on with the exact size.
+	 */
+	grow = min_t(unsigned long, node->alloc_size, MAX_GROW_SIZE);
+	if (grow > add) {
+		data = ramfs_get_chunk(grow);
+		if (data) {
+			data->ofs = node->alloc_size;
+			list_add_tail(&data->list, &node->data);
+			node->alloc_size += data->size;
+			return 0;
+		}
+	}
+
 	/*
 	 * We first try to allocate all space we need in a single chunk.
 	 * This may fail because of fragmented memory, so in case we cannot
@@ -386,6 +410,10 @@ static int ramfs_memmap(struct device *_dev, struct file *f, void **map, int fla
 	if (list_empty(&node->data))
 		return -EINVAL;
 
+	/*
+	 * Don't merge multiple chunks here: that costs as much as the read()
+	 * fallback of the callers and silently keeps a second copy around.
+	 */
 	if (!list_is_singular(&node->data))
 		return -EINVAL;
 
@@ -690,10 +690,26 @@ static void destroy_journal(struct ubifs_info *c)
 	free_buds(c);
 }
 
-/*
- * removed in barebox
-static void bu_init(struct ubifs_info *c)
+/**
+ * bu_init - initialize bulk-read information.
+ * @c: UBIFS file-system description object
  */
+static void bu_init(struct ubifs_info *c)
+{
+	ubifs_assert(c, c->bulk_read == 1);
+
+	if (c->bu.buf)
+		return; /* Already initialized */
+
+	c->bu.buf = kmalloc(c->max_bu_buf_len, GFP_KERNEL | __GFP_NOWARN);
+	if (!c->bu.buf) {
+		/* Just disable bulk-read */
+		ubifs_warn(c, "cannot allocate %d bytes of memory for bulk-read, disabling it",
+			   c->max_bu_buf_len);
+		c->bulk_read = 0;
+		return;
+	}
+}
 
 /*
  * removed in barebox
@@ -797,6 +813,10 @@ static int mount_ubifs(struct ubifs_info *c)
 	if (err)
 		goto out_free;
 
+	/* barebox has no mount options, file data is always bulk-read */
+	c->bulk_read = 1;
+	bu_init(c);
+
 	sz = ALIGN(c->max_idx_node_sz, c->min_io_size);
 	sz = ALIGN(sz + c->max_idx_node_sz, c->min_io_size);
 	c->cbuf = kmalloc(sz, GFP_NOFS);
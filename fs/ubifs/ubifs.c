@@ -286,23 +286,13 @@ int __init ubifs_compressors_init(void)
 
 /* file.c */
 
-static int read_block(struct inode *inode, void *addr, unsigned int block,
-		      struct ubifs_data_node *dn)
+static int decompress_block(struct inode *inode, void *addr, unsigned int block,
+			    struct ubifs_data_node *dn)
 {
 	struct ubifs_info *c = inode->i_sb->s_fs_info;
 	int err, len, out_len;
-	union ubifs_key key;
 	unsigned int dlen;
 
-	data_key_init(c, &key, inode->i_ino, block);
-	err = ubifs_tnc_lookup(c, &key, dn);
-	if (err) {
-		if (err == -ENOENT)
-			/* Not found, so it must be a hole */
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
-		return err;
-	}
-
 	ubifs_assert(c, le64_to_cpu(dn->ch.sqnum) > ubifs_inode(inode)->creat_sqnum);
 
 	len = le32_to_cpu(dn->size);
@@ -333,6 +323,89 @@ static int read_block(struct inode *inode, void *addr, unsigned int block,
 	return -EINVAL;
 }
 
+static int read_block(struct inode *inode, void *addr, unsigned int block,
+		      struct ubifs_data_node *dn)
+{
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	union ubifs_key key;
+	int err;
+
+	data_key_init(c, &key, inode->i_ino, block);
+	err = ubifs_tnc_lookup(c, &key, dn);
+	if (err) {
+		if (err == -ENOENT)
+			/* Not found, so it must be a hole */
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+		return err;
+	}
+
+	return decompress_block(inode, addr, block, dn);
+}
+
+/**
+ * bulk_read_blocks - read consecutive blocks with a single flash read
+ * @inode: inode to read from
+ * @addr: buffer for the blocks
+ * @block: first block to read
+ * @nblocks: maximum number of blocks to read
+ *
+ * This function finds the run of data nodes following @block which are stored
+ * back to back in the same LEB, reads them with one UBI read and decompresses
+ * them straight into @addr. Blocks in between without a data node are holes.
+ *
+ * Returns the number of blocks read, 0 if @block has to be read with
+ * read_block(), or a negative error code.
+ */
+static int bulk_read_blocks(struct inode *inode, void *addr, unsigned int block,
+			    unsigned int nblocks)
+{
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	struct bu_info *bu = &c->bu;
+	unsigned int n = 0, nb;
+	void *buf;
+	int err, i;
+
+	if (!c->bulk_read || nblocks < 2)
+		return 0;
+
+	data_key_init(c, &bu->key, inode->i_ino, block);
+	bu->buf_len = c->max_bu_buf_len;
+
+	err = ubifs_tnc_get_bu_keys(c, bu);
+	if (err)
+		return err;
+
+	/* Don't read nodes past the requested blocks */
+	while (bu->cnt &&
+	       key_block(c, &bu->zbranch[bu->cnt - 1].key) >= block + nblocks)
+		bu->cnt -= 1;
+	if (!bu->cnt)
+		return 0;
+
+	err = ubifs_tnc_bulk_read(c, bu);
+	if (err == -EAGAIN)
+		return 0;
+	if (err)
+		return err;
+
+	buf = bu->buf;
+	for (i = 0; i < bu->cnt; i++) {
+		nb = key_block(c, &bu->zbranch[i].key) - block;
+
+		memset(addr + n * UBIFS_BLOCK_SIZE, 0, (nb - n) * UBIFS_BLOCK_SIZE);
+
+		err = decompress_block(inode, addr + nb * UBIFS_BLOCK_SIZE,
+				       block + nb, buf);
+		if (err)
+			return err;
+
+		n = nb + 1;
+		buf += ALIGN(bu->zbranch[i].len, 8);
+	}
+
+	return n;
+}
+
 struct ubifs_file {
 	struct inode *inode;
 	void *buf;
@@ -406,16 +479,27 @@ static int ubifs_read(struct device *_dev, struct file *f, void *buf, size_t ins
 		buf += now;
 	}
 
-	/* Do full blocks */
+	/* Do full blocks, bulk-read them directly into the buffer if possible */
 	while (size >= UBIFS_BLOCK_SIZE) {
-		ret = ubifs_get_block(uf, pos);
-		if (ret)
+		ret = bulk_read_blocks(uf->inode, buf, pos / UBIFS_BLOCK_SIZE,
+				       size / UBIFS_BLOCK_SIZE);
+		if (ret < 0)
 			return ret;
 
-		memcpy(buf, uf->buf, UBIFS_BLOCK_SIZE);
-		size -= UBIFS_BLOCK_SIZE;
-		pos += UBIFS_BLOCK_SIZE;
-		buf += UBIFS_BLOCK_SIZE;
+		if (ret) {
+			now = ret * UBIFS_BLOCK_SIZE;
+		} else {
+			ret = ubifs_get_block(uf, pos);
+			if (ret)
+				return ret;
+
+			now = UBIFS_BLOCK_SIZE;
+			memcpy(buf, uf->buf, now);
+		}
+
+		size -= now;
+		pos += now;
+		buf += now;
 	}
 
 	/* And the rest */
@@ -138,6 +138,10 @@ void bootm_data_init_defaults(struct bootm_data *data);
 void bootm_data_restore_defaults(const struct bootm_data *data);
 
 int bootm_load_os(struct image_data *data, unsigned long load_address);
+unsigned long bootm_fit_kernel_in_place(struct image_data *data,
+					unsigned long align,
+					unsigned long offset,
+					unsigned long size);
 
 const struct resource *
 bootm_load_initrd(struct image_data *data, unsigned long load_address);
@@ -36,6 +36,8 @@ struct console_device {
 	int  (*getc)(struct console_device *cdev);
 	int (*setbrg)(struct console_device *cdev, int baudrate);
 	void (*flush)(struct console_device *cdev);
+	/* optional: returns true if putc won't have to wait */
+	int (*tx_ready)(struct console_device *cdev);
 	int (*set_mode)(struct console_device *cdev, enum console_mode mode);
 	int (*open)(struct console_device *cdev);
 	int (*close)(struct console_device *cdev);
@@ -60,6 +62,8 @@ struct console_device {
 	struct cdev devfs;
 	struct cdev_operations fops;
 
+	struct kfifo *tx_fifo;
+
 	struct serdev_device serdev;
 };
 
@@ -101,6 +105,14 @@ int console_close(struct console_device *cdev);
 int console_set_active(struct console_device *cdev, unsigned active);
 unsigned console_get_active(struct console_device *cdev);
 int console_set_baudrate(struct console_device *cdev, unsigned baudrate);
+
+#ifdef CONFIG_CONSOLE_TX_BUFFER
+void console_tx_flush(struct console_device *cdev);
+#else
+static inline void console_tx_flush(struct console_device *cdev)
+{
+}
+#endif
 unsigned console_get_baudrate(struct console_device *cdev);
 void console_set_stdoutpath(struct console_device *cdev, unsigned baudrate);
 
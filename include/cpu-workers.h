@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __CPU_WORKERS_H
+#define __CPU_WORKERS_H
+
+#include <linux/types.h>
+
+/*
+ * Work items run concurrently on all CPUs barebox has brought up. They
+ * must only compute on the memory they are handed: no console output,
+ * no allocations, no driver or filesystem access.
+ */
+typedef void (*cpu_work_fn)(unsigned int item, void *data);
+
+#ifdef CONFIG_HAS_CPU_WORKERS
+unsigned int cpu_workers_count(void);
+void cpu_workers_run(cpu_work_fn fn, void *data, unsigned int nitems);
+bool cpu_workers_follow_remap(void);
+#else
+static inline unsigned int cpu_workers_count(void)
+{
+	return 1;
+}
+
+static inline bool cpu_workers_follow_remap(void)
+{
+	return true;
+}
+
+static inline void cpu_workers_run(cpu_work_fn fn, void *data,
+				   unsigned int nitems)
+{
+	unsigned int i;
+
+	for (i = 0; i < nitems; i++)
+		fn(i, data);
+}
+#endif
+
+#endif /* __CPU_WORKERS_H */
@@ -5,9 +5,31 @@
 
 #include <digest.h>
 #include <types.h>
+#include <crypto/sha.h>
+#include <linux/errno.h>
+
+/*
+ * SHA-256 context for the PBL. The ARMv8 Crypto Extensions transform
+ * expects a finalize flag after the generic state.
+ */
+struct pbl_sha256_state {
+	struct sha256_state sst;
+	u32 finalize;
+};
 
 int sha256_init(struct digest *desc);
 int sha256_update(struct digest *desc, const void *data, unsigned long len);
 int sha256_final(struct digest *desc, u8 *out);
 
+#ifdef CONFIG_PBL_DIGEST_SHA256_ARM64_CE
+int sha256_ce_pbl_update(struct digest *desc, const void *data,
+			 unsigned long len);
+#else
+static inline int sha256_ce_pbl_update(struct digest *desc, const void *data,
+				       unsigned long len)
+{
+	return -ENOSYS;
+}
+#endif
+
 #endif /* __PBL-SHA_H_ */
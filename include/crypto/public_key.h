@@ -2,6 +2,7 @@
 #define __CRYPTO_PUBLIC_KEY_H
 
 #include <digest.h>
+#include <crypto/sha.h>
 
 struct rsa_public_key;
 struct ecdsa_public_key;
@@ -16,6 +17,10 @@ struct public_key {
 	struct list_head list;
 	char *key_name_hint;
 
+	/* SHA-256 over the public key material, see public_key_fingerprint() */
+	unsigned char fingerprint[SHA256_DIGEST_SIZE];
+	struct hlist_node hash_node;
+
 	union {
 		struct rsa_public_key *rsa;
 		struct ecdsa_public_key *ecdsa;
@@ -23,7 +28,10 @@ struct public_key {
 };
 
 int public_key_add(struct public_key *key);
+void public_key_del(struct public_key *key);
 const struct public_key *public_key_get(const char *name);
+const struct public_key *public_key_get_by_fingerprint(const void *fp,
+							size_t len);
 const struct public_key *public_key_next(const struct public_key *prev);
 
 #define for_each_public_key(key) \
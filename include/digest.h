@@ -95,6 +95,10 @@ int digest_file(struct digest *d, const char *filename,
 int digest_file_by_name(const char *algo, const char *filename,
 			unsigned char *hash,
 			const unsigned char *sig);
+
+int digest_chunks_verify(const char *algo, const void *data, size_t size,
+			 size_t chunk_size, const void *chunk_hashes,
+			 size_t first, size_t nchunks);
 #else
 static inline struct digest *digest_alloc(const char *name)
 {
@@ -109,6 +113,14 @@ static inline struct digest *digest_alloc_by_algo(enum hash_algo algo)
 static inline void digest_free(struct digest *d)
 {
 }
+
+static inline int digest_chunks_verify(const char *algo, const void *data,
+				       size_t size, size_t chunk_size,
+				       const void *chunk_hashes,
+				       size_t first, size_t nchunks)
+{
+	return -ENOSYS;
+}
 #endif
 
 static inline int digest_init(struct digest *d)
@@ -8,6 +8,7 @@
 
 #include <linux/types.h>
 #include <bootm.h>
+#include <stringlist.h>
 
 struct fit_handle {
 	const void *fit;
@@ -20,6 +21,9 @@ struct fit_handle {
 	struct device_node *root;
 	struct device_node *images;
 	struct device_node *configurations;
+
+	/* full names of hash and signature nodes successfully verified */
+	struct string_list verified;
 };
 
 struct fit_handle *fit_open(const char *filename, bool verbose,
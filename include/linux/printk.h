@@ -179,14 +179,26 @@ int __pr_memory_display(int level, const void *addr, loff_t offs, unsigned nbyte
 				(offs), (nbytes), (size), (swab), pr_fmt("")) : 0; \
 	 })
 
+/*
+ * Binary record of the log buffer, laid out like the records of the Linux
+ * printk buffer: a timestamp in nanoseconds, the total record length
+ * (8 byte aligned), the message length and the log level, followed by the
+ * NUL-terminated message.
+ */
 struct log_entry {
-	struct list_head list;
 	uint64_t timestamp;
-	int level;
+	uint16_t len;
+	uint16_t msg_len;
+	uint8_t level;
+	uint8_t reserved[3];
 	char msg[];
 };
 
-extern struct list_head barebox_logbuf;
+struct log_entry *log_first(void);
+struct log_entry *log_next(const struct log_entry *log);
+
+#define for_each_log_entry(log) \
+	for (log = log_first(); log; log = log_next(log))
 
 extern void log_clean(unsigned int limit);
 
@@ -17,11 +17,16 @@
 
 #define OF_BAD_ADDR      ((u64)-1)
 
+/* property name and/or value live in the same allocation as the property */
+#define OF_PROPERTY_INLINE_NAME		(1 << 0)
+#define OF_PROPERTY_INLINE_VALUE	(1 << 1)
+
 typedef u32 phandle;
 
 struct property {
 	const char *name;
 	int length;
+	unsigned int flags;
 	void *value;
 	const void *value_const;
 	struct list_head list;
@@ -158,8 +163,13 @@ extern struct property *of_new_property(struct device_node *node,
 extern struct property *of_new_property_const(struct device_node *node,
 					      const char *name,
 					      const void *data, int len);
+extern struct property *of_new_property_inline(struct device_node *node,
+					       const char *name,
+					       const void *data, int len);
 extern struct property *__of_new_property(struct device_node *node,
 					  const char *name, void *data, int len);
+extern void of_property_free_value(struct property *pp);
+extern unsigned long of_get_tree_generation(void);
 extern void of_delete_property(struct property *pp);
 extern struct property *of_rename_property(struct device_node *np,
 					   const char *old_name, const char *new_name);
@@ -307,6 +317,8 @@ extern int of_parse_phandle_with_args(const struct device_node *np,
 	struct of_phandle_args *out_args);
 extern int of_count_phandle_with_args(const struct device_node *np,
 	const char *list_name, const char *cells_name);
+extern int of_get_suppliers(const struct device_node *np,
+			    struct device_node ***suppliers);
 
 extern void of_alias_scan(void);
 extern int of_alias_get_id(struct device_node *np, const char *stem);
@@ -368,13 +380,17 @@ struct cdev *of_cdev_find(struct device_node *node);
 int of_find_path_by_node(struct device_node *node, char **outpath, unsigned flags);
 struct device_node *of_find_node_by_devpath(struct device_node *root, const char *path);
 int of_register_fixup(int (*fixup)(struct device_node *, void *), void *context);
+int of_register_tree_fixup(int (*fixup)(struct device_node *, void *),
+			   void *context);
 int of_unregister_fixup(int (*fixup)(struct device_node *, void *), void *context);
+void of_fixups_changed(void);
 
 struct of_fixup {
 	int (*fixup)(struct device_node *, void *);
 	void *context;
 	struct list_head list;
 	bool disabled;
+	bool tree_only;
 };
 
 extern struct list_head of_fixup_list;
@@ -823,6 +839,13 @@ static inline int of_count_phandle_with_args(const struct device_node *np,
 	return -ENOSYS;
 }
 
+static inline int of_get_suppliers(const struct device_node *np,
+				   struct device_node ***suppliers)
+{
+	*suppliers = NULL;
+	return 0;
+}
+
 static inline struct device_node *of_find_node_by_path_from(
 	struct device_node *from, const char *path)
 {
@@ -1018,6 +1041,12 @@ static inline int of_register_fixup(int (*fixup)(struct device_node *, void *),
 	return -ENOSYS;
 }
 
+static inline int of_register_tree_fixup(int (*fixup)(struct device_node *, void *),
+					 void *context)
+{
+	return -ENOSYS;
+}
+
 static inline struct device_node *of_find_node_by_alias(
 				struct device_node *root, const char *alias)
 {
@@ -1364,6 +1393,9 @@ struct of_overlay_filter {
 #ifdef CONFIG_OF_OVERLAY
 struct device_node *of_resolve_phandles(struct device_node *root,
 					const struct device_node *overlay);
+struct device_node *__of_resolve_phandles(struct device_node *root,
+					  const struct device_node *overlay,
+					  phandle *max_phandle);
 int of_overlay_apply_tree(struct device_node *root,
 			  struct device_node *overlay);
 int of_overlay_apply_file(struct device_node *root, const char *filename,
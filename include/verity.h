@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __VERITY_H
+#define __VERITY_H
+
+#include <linux/types.h>
+
+struct cdev;
+
+#define VERITY_MAX_DIGEST_SIZE	64
+#define VERITY_MAX_SALT_SIZE	256
+
+/**
+ * struct verity_params - parameters of a dm-verity (format 1) hash tree
+ * @algo: digest algorithm, e.g. "sha256"
+ * @root_digest: trusted root digest of the hash tree
+ * @root_digest_size: number of valid bytes in @root_digest
+ * @salt: salt hashed before each block
+ * @salt_size: number of valid bytes in @salt
+ * @data_block_size: size of the blocks on the data device
+ * @hash_block_size: size of the blocks on the hash device
+ * @data_blocks: number of data blocks covered by the tree
+ * @hash_start: byte offset of the hash tree on the hash device
+ */
+struct verity_params {
+	char algo[32];
+	u8 root_digest[VERITY_MAX_DIGEST_SIZE];
+	unsigned int root_digest_size;
+	u8 salt[VERITY_MAX_SALT_SIZE];
+	unsigned int salt_size;
+	unsigned int data_block_size;
+	unsigned int hash_block_size;
+	u64 data_blocks;
+	loff_t hash_start;
+};
+
+int verity_read_superblock(struct cdev *hash, loff_t offset,
+			   struct verity_params *params);
+struct cdev *verity_create(const char *name, struct cdev *data,
+			   struct cdev *hash, const struct verity_params *params);
+
+#endif /* __VERITY_H */
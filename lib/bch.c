@@ -42,8 +42,9 @@
  *
  * Algorithmic details:
  *
- * Encoding is performed by processing 32 input bits in parallel, using 4
- * remainder lookup tables.
+ * Encoding is performed by processing 64 input bits in parallel, using 8
+ * remainder lookup tables (slicing-by-8). Tables 4..7 are derived from tables
+ * 0..3 by multiplying their entries with X^32 modulo the generator polynomial.
  *
  * The final stage of decoding involves the following internal steps:
  * a. Syndrome computation
@@ -203,21 +204,40 @@ static void store_ecc8(struct bch_control *bch, uint8_t *dst,
  * The exact number of computed ecc parity bits is given by member @ecc_bits of
  * @bch; it may be less than m*t for large values of t.
  */
+static inline uint32_t bch_load_word(struct bch_control *bch,
+				     const uint32_t *pdata)
+{
+	/* input data is read in big-endian format */
+	uint32_t w = cpu_to_be32(*pdata);
+
+	if (bch->swap_bits)
+		w = (u32)swap_bits(bch, w) |
+		    ((u32)swap_bits(bch, w >> 8) << 8) |
+		    ((u32)swap_bits(bch, w >> 16) << 16) |
+		    ((u32)swap_bits(bch, w >> 24) << 24);
+
+	return w;
+}
+
 void bch_encode(struct bch_control *bch, const uint8_t *data,
 		unsigned int len, uint8_t *ecc)
 {
 	const unsigned int l = BCH_ECC_WORDS(bch)-1;
 	unsigned int i, mlen;
 	unsigned long m;
-	uint32_t w, r[BCH_ECC_MAX_WORDS];
+	uint32_t w, v, r[BCH_ECC_MAX_WORDS + 1];
 	const size_t r_bytes = BCH_ECC_WORDS(bch) * sizeof(*r);
 	const uint32_t * const tab0 = bch->mod8_tab;
 	const uint32_t * const tab1 = tab0 + 256*(l+1);
 	const uint32_t * const tab2 = tab1 + 256*(l+1);
 	const uint32_t * const tab3 = tab2 + 256*(l+1);
-	const uint32_t *pdata, *p0, *p1, *p2, *p3;
+	const uint32_t * const tab4 = tab3 + 256*(l+1);
+	const uint32_t * const tab5 = tab4 + 256*(l+1);
+	const uint32_t * const tab6 = tab5 + 256*(l+1);
+	const uint32_t * const tab7 = tab6 + 256*(l+1);
+	const uint32_t *pdata, *p0, *p1, *p2, *p3, *p4, *p5, *p6, *p7;
 
-	if (WARN_ON(r_bytes > sizeof(r)))
+	if (WARN_ON(r_bytes >= sizeof(r)))
 		return;
 
 	if (ecc) {
@@ -242,6 +262,41 @@ void bch_encode(struct bch_control *bch, const uint8_t *data,
 	data += 4*mlen;
 	len  -= 4*mlen;
 	memcpy(r, bch->ecc_buf, r_bytes);
+	/* one extra zero word, so r[1] is valid for single word remainders */
+	r[l+1] = 0;
+
+	/*
+	 * split each 64-bit chunk into 8 polynomials of weight 8, the first
+	 * 32-bit word w being the most significant one and v the other:
+	 *
+	 * 63 ...56  ...  39 ...32  31 ...24  ...  7 ... 0
+	 * wwwwwwww  ...  wwwwwwww  vvvvvvvv  ...  vvvvvvvv
+	 *
+	 * each byte is looked up in the table for its position (tab7 for the
+	 * most significant byte, tab0 for the least significant byte) and the
+	 * results are XORed, see below for the 32-bit case.
+	 */
+	while (mlen >= 2) {
+		w = bch_load_word(bch, pdata++) ^ r[0];
+		v = bch_load_word(bch, pdata++) ^ r[1];
+		mlen -= 2;
+
+		p0 = tab0 + (l+1)*((v >>  0) & 0xff);
+		p1 = tab1 + (l+1)*((v >>  8) & 0xff);
+		p2 = tab2 + (l+1)*((v >> 16) & 0xff);
+		p3 = tab3 + (l+1)*((v >> 24) & 0xff);
+		p4 = tab4 + (l+1)*((w >>  0) & 0xff);
+		p5 = tab5 + (l+1)*((w >>  8) & 0xff);
+		p6 = tab6 + (l+1)*((w >> 16) & 0xff);
+		p7 = tab7 + (l+1)*((w >> 24) & 0xff);
+
+		for (i = 0; i < l; i++)
+			r[i] = r[i+2]^p0[i]^p1[i]^p2[i]^p3[i]^
+			       p4[i]^p5[i]^p6[i]^p7[i];
+
+		r[l] = p0[l]^p1[l]^p2[l]^p3[l]^p4[l]^p5[l]^p6[l]^p7[l];
+		r[l+1] = 0;
+	}
 
 	/*
 	 * split each 32-bit word into 4 polynomials of weight 8 as follows:
@@ -255,14 +310,7 @@ void bch_encode(struct bch_control *bch, const uint8_t *data,
 	 * xxxxxxxx  yyyyyyyy  zzzzzzzz  tttttttt  mod g = r0^r1^r2^r3
 	 */
 	while (mlen--) {
-		/* input data is read in big-endian format */
-		w = cpu_to_be32(*pdata++);
-		if (bch->swap_bits)
-			w = (u32)swap_bits(bch, w) |
-			    ((u32)swap_bits(bch, w >> 8) << 8) |
-			    ((u32)swap_bits(bch, w >> 16) << 16) |
-			    ((u32)swap_bits(bch, w >> 24) << 24);
-		w ^= r[0];
+		w = bch_load_word(bch, pdata++) ^ r[0];
 		p0 = tab0 + (l+1)*((w >>  0) & 0xff);
 		p1 = tab1 + (l+1)*((w >>  8) & 0xff);
 		p2 = tab2 + (l+1)*((w >> 16) & 0xff);
@@ -1118,7 +1166,7 @@ static void build_mod8_tables(struct bch_control *bch, const uint32_t *g)
 	const int plen = DIV_ROUND_UP(bch->ecc_bits+1, 32);
 	const int ecclen = DIV_ROUND_UP(bch->ecc_bits, 32);
 
-	memset(bch->mod8_tab, 0, 4*256*l*sizeof(*bch->mod8_tab));
+	memset(bch->mod8_tab, 0, 8*256*l*sizeof(*bch->mod8_tab));
 
 	for (i = 0; i < 256; i++) {
 		/* p(X)=i is a small polynomial of weight <= 8 */
@@ -1139,6 +1187,26 @@ static void build_mod8_tables(struct bch_control *bch, const uint32_t *g)
 			}
 		}
 	}
+
+	/*
+	 * (p(X).X^(8*b+32+deg(g))) mod g(X) for b=0..3 is obtained by feeding
+	 * a zero 32-bit word into the remainder (p(X).X^(8*b+deg(g))) mod g(X)
+	 */
+	for (i = 0; i < 4*256; i++) {
+		const uint32_t *src = bch->mod8_tab + i*l;
+		const uint32_t *p0, *p1, *p2, *p3;
+
+		tab = bch->mod8_tab + (4*256+i)*l;
+		data = src[0];
+		p0 = bch->mod8_tab + (0*256 + ((data >>  0) & 0xff))*l;
+		p1 = bch->mod8_tab + (1*256 + ((data >>  8) & 0xff))*l;
+		p2 = bch->mod8_tab + (2*256 + ((data >> 16) & 0xff))*l;
+		p3 = bch->mod8_tab + (3*256 + ((data >> 24) & 0xff))*l;
+
+		for (j = 0; j < l; j++)
+			tab[j] = ((j+1 < l) ? src[j+1] : 0)^
+				 p0[j]^p1[j]^p2[j]^p3[j];
+	}
 }
 
 /*
@@ -1340,7 +1408,7 @@ struct bch_control *bch_init(int m, int t, unsigned int prim_poly,
 	bch->ecc_bytes = DIV_ROUND_UP(m*t, 8);
 	bch->a_pow_tab = bch_alloc((1+bch->n)*sizeof(*bch->a_pow_tab), &err);
 	bch->a_log_tab = bch_alloc((1+bch->n)*sizeof(*bch->a_log_tab), &err);
-	bch->mod8_tab  = bch_alloc(words*1024*sizeof(*bch->mod8_tab), &err);
+	bch->mod8_tab  = bch_alloc(words*2048*sizeof(*bch->mod8_tab), &err);
 	bch->ecc_buf   = bch_alloc(words*sizeof(*bch->ecc_buf), &err);
 	bch->ecc_buf2  = bch_alloc(words*sizeof(*bch->ecc_buf2), &err);
 	bch->xi_tab    = bch_alloc(m*sizeof(*bch->xi_tab), &err);
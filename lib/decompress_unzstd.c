@@ -53,7 +53,22 @@
  *                 <= 22 + (uncompressed_size >> 15) + 131072
  */
 
-#ifndef STATIC
+#ifdef STATIC
+/*
+ * Code active when included from the PBL: build the decoder into this
+ * compilation unit. Nothing is exported from the PBL.
+ */
+#include <linux/export.h>
+#undef EXPORT_SYMBOL
+#define EXPORT_SYMBOL(sym)
+#include "xxhash.c"
+#include "zstd/entropy_common.c"
+#include "zstd/fse_decompress.c"
+#undef CHECK_F
+#include "zstd/huf_decompress.c"
+#include "zstd/zstd_common.c"
+#include "zstd/decompress.c"
+#else
 #include <linux/decompress/unzstd.h>
 #endif
 
@@ -318,3 +333,4 @@ STATIC int INIT unzstd(unsigned char *buf, long len,
 {
 	return __unzstd(buf, len, fill, flush, out_buf, 0, pos, error);
 }
+#define decompress unzstd
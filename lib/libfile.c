@@ -21,6 +21,9 @@
 #include <progress.h>
 #include <stdlib.h>
 #include <linux/stat.h>
+#include <ioctl.h>
+#include <linux/sizes.h>
+#include <linux/mtd/mtd-abi.h>
 
 /*
  * pwrite_full - write to filedescriptor at offset
@@ -428,12 +431,101 @@ int write_file_flash(const char *filename, const void *buf, size_t size)
 }
 EXPORT_SYMBOL(write_file_flash);
 
+#define COPY_BUF_SIZE		SZ_256K
+#define COPY_BUF_SIZE_MAX	SZ_4M
+
+/*
+ * copy_buf_size - pick a transfer size suitable for the devices behind @fd
+ *
+ * Flash devices are best written in multiples of their eraseblock size,
+ * everything else gets a buffer large enough to keep the block layer
+ * busy.
+ */
+static size_t copy_buf_size(int fd)
+{
+	struct mtd_info_user meminfo;
+	size_t size = COPY_BUF_SIZE;
+
+	if (!ioctl(fd, MEMGETINFO, &meminfo) && meminfo.erasesize &&
+	    meminfo.erasesize <= COPY_BUF_SIZE_MAX)
+		size = roundup(size, meminfo.erasesize);
+
+	return size;
+}
+
+static void *copy_buf_alloc(size_t *size)
+{
+	void *buf;
+
+	buf = malloc(*size);
+	if (buf)
+		return buf;
+
+	*size = RW_BUF_SIZE;
+
+	return xmalloc(*size);
+}
+
+/*
+ * Map a file for reading. Mappings that include the zero page are not
+ * directly accessible and are treated as if the file could not be mapped.
+ */
+static const void *copy_memmap(int fd)
+{
+	void *map = memmap(fd, PROT_READ);
+
+	if (map != MAP_FAILED && zero_page_contains((ulong)map))
+		return MAP_FAILED;
+
+	return map;
+}
+
+static void copy_file_progress(loff_t total, loff_t size)
+{
+	if (size && size != FILESIZE_MAX)
+		show_progress(total);
+	else
+		show_progress(total / 16384);
+}
+
+/*
+ * Copy from a memory mapped source. The data is written directly from the
+ * mapping, no bounce buffer is needed.
+ */
+static int copy_file_mapped(int dstfd, const void *map, loff_t size,
+			    size_t bufsize, int verbose)
+{
+	loff_t total = 0;
+	int ret;
+
+	while (total < size) {
+		size_t now = min_t(loff_t, bufsize, size - total);
+
+		ret = write_full(dstfd, map + total, now);
+		if (ret < 0) {
+			perror("write");
+			return ret;
+		}
+
+		total += now;
+
+		if (verbose)
+			copy_file_progress(total, size);
+	}
+
+	return 0;
+}
+
 /**
  * copy_file - Copy a file
  * @src:	The source filename
  * @dst:	The destination filename
  * @verbose:	if true, show a progression bar
  *
+ * The transfer size is chosen based on the eraseblock size of source and
+ * destination. When the source is memory mapped, data is written directly
+ * from the mapping.
+ *
  * Return: 0 for success or negative error code
  */
 int copy_file(const char *src, const char *dst, int verbose)
@@ -444,10 +536,10 @@ int copy_file(const char *src, const char *dst, int verbose)
 	int ret = 1, err1 = 0;
 	int mode;
 	loff_t total = 0;
+	size_t bufsize;
+	const void *map;
 	struct stat srcstat, dststat;
 
-	rw_buf = xmalloc(RW_BUF_SIZE);
-
 	srcfd = open(src, O_RDONLY);
 	if (srcfd < 0) {
 		printf("could not open %s: %m\n", src);
@@ -488,11 +580,24 @@ int copy_file(const char *src, const char *dst, int verbose)
 		}
 	}
 
+	bufsize = max(copy_buf_size(srcfd), copy_buf_size(dstfd));
+
 	if (verbose)
 		init_progression_bar(srcstat.st_size);
 
+	if (srcstat.st_size != FILESIZE_MAX) {
+		map = copy_memmap(srcfd);
+		if (map != MAP_FAILED) {
+			ret = copy_file_mapped(dstfd, map, srcstat.st_size,
+					       bufsize, verbose);
+			goto out;
+		}
+	}
+
+	rw_buf = copy_buf_alloc(&bufsize);
+
 	while (1) {
-		r = read(srcfd, rw_buf, RW_BUF_SIZE);
+		r = read_full(srcfd, rw_buf, bufsize);
 		if (r < 0) {
 			perror("read");
 			ret = r;
@@ -509,12 +614,8 @@ int copy_file(const char *src, const char *dst, int verbose)
 
 		total += r;
 
-		if (verbose) {
-			if (srcstat.st_size && srcstat.st_size != FILESIZE_MAX)
-				show_progress(total);
-			else
-				show_progress(total / 16384);
-		}
+		if (verbose)
+			copy_file_progress(total, srcstat.st_size);
 	}
 
 	ret = 0;
@@ -585,6 +686,8 @@ int compare_file(const char *f1, const char *f2)
 	int fd1, fd2, ret;
 	struct stat s1, s2;
 	void *buf1, *buf2;
+	const void *map1, *map2;
+	size_t bufsize;
 	loff_t left;
 
 	fd1 = open(f1, O_RDONLY);
@@ -610,22 +713,43 @@ int compare_file(const char *f1, const char *f2)
 		goto err_out2;
 	}
 
-	buf1 = xmalloc(RW_BUF_SIZE);
-	buf2 = xmalloc(RW_BUF_SIZE);
+	map1 = copy_memmap(fd1);
+	map2 = copy_memmap(fd2);
+
+	if (map1 != MAP_FAILED && map2 != MAP_FAILED) {
+		ret = memcmp(map1, map2, s1.st_size) ? 1 : 0;
+		goto err_out2;
+	}
+
+	bufsize = max(copy_buf_size(fd1), copy_buf_size(fd2));
+
+	buf1 = map1 == MAP_FAILED ? copy_buf_alloc(&bufsize) : NULL;
+	buf2 = map2 == MAP_FAILED ? copy_buf_alloc(&bufsize) : NULL;
 
 	left = s1.st_size;
 	while (left) {
-		loff_t now = min(left, (loff_t)RW_BUF_SIZE);
-
-		ret = read_full(fd1, buf1, now);
-		if (ret < 0)
-			goto err_out3;
+		loff_t now = min(left, (loff_t)bufsize);
+		const void *p1, *p2;
+
+		if (buf1) {
+			ret = read_full(fd1, buf1, now);
+			if (ret < 0)
+				goto err_out3;
+			p1 = buf1;
+		} else {
+			p1 = map1 + s1.st_size - left;
+		}
 
-		ret = read_full(fd2, buf2, now);
-		if (ret < 0)
-			goto err_out3;
+		if (buf2) {
+			ret = read_full(fd2, buf2, now);
+			if (ret < 0)
+				goto err_out3;
+			p2 = buf2;
+		} else {
+			p2 = map2 + s1.st_size - left;
+		}
 
-		if (memcmp(buf1, buf2, now)) {
+		if (memcmp(p1, p2, now)) {
 			ret = 1;
 			goto err_out3;
 		}
@@ -746,24 +870,22 @@ int cache_file(const char *path, char **newpath)
 
 #define BUFSIZ	(PAGE_SIZE * 32)
 
-struct resource *file_to_sdram(const char *filename, unsigned long adr)
+/*
+ * Load a file of unknown size by growing the SDRAM region while reading
+ */
+static struct resource *file_to_sdram_stream(int fd, unsigned long adr)
 {
 	struct resource *res;
 	size_t size = BUFSIZ;
 	size_t ofs = 0;
 	ssize_t now;
-	int fd;
-
-	fd = open(filename, O_RDONLY);
-	if (fd < 0)
-		return NULL;
 
 	while (1) {
 		res = request_sdram_region("image", adr, size);
 		if (!res) {
 			printf("unable to request SDRAM 0x%08lx-0x%08lx\n",
 				adr, adr + size - 1);
-			goto out;
+			return NULL;
 		}
 
 		if (zero_page_contains(res->start + ofs)) {
@@ -782,14 +904,12 @@ struct resource *file_to_sdram(const char *filename, unsigned long adr)
 
 		if (now < 0) {
 			release_sdram_region(res);
-			res = NULL;
-			goto out;
+			return NULL;
 		}
 
 		if (now < BUFSIZ) {
 			release_sdram_region(res);
-			res = request_sdram_region("image", adr, ofs + now);
-			goto out;
+			return request_sdram_region("image", adr, ofs + now);
 		}
 
 		release_sdram_region(res);
@@ -797,7 +917,96 @@ struct resource *file_to_sdram(const char *filename, unsigned long adr)
 		ofs += BUFSIZ;
 		size += BUFSIZ;
 	}
-out:
+}
+
+/*
+ * Load a file of known size with a single SDRAM request. The data is copied
+ * once if the file can be memory mapped, otherwise it is read directly into
+ * the destination.
+ */
+static struct resource *file_to_sdram_sized(int fd, unsigned long adr,
+					    size_t size)
+{
+	struct resource *res;
+	void *buf, *map;
+	size_t ofs = 0;
+	ssize_t now;
+
+	res = request_sdram_region("image", adr, size);
+	if (!res) {
+		printf("unable to request SDRAM 0x%08lx-0x%08lx\n",
+			adr, adr + size - 1);
+		return NULL;
+	}
+
+	buf = (void *)res->start;
+
+	map = memmap(fd, PROT_READ);
+	if (map != MAP_FAILED) {
+		if (zero_page_contains(res->start))
+			zero_page_memcpy(buf, map, size);
+		else
+			memcpy(buf, map, size);
+
+		return res;
+	}
+
+	if (zero_page_contains(res->start)) {
+		size_t len = min_t(size_t, PAGE_SIZE - res->start, size);
+		void *tmp = malloc(len);
+
+		if (!tmp)
+			now = -ENOMEM;
+		else
+			now = read_full(fd, tmp, len);
+
+		if (now > 0)
+			zero_page_memcpy(buf, tmp, now);
+		free(tmp);
+
+		if (now < 0)
+			goto err;
+
+		ofs = now;
+	}
+
+	if (ofs < size) {
+		now = read_full(fd, buf + ofs, size - ofs);
+		if (now < 0)
+			goto err;
+
+		ofs += now;
+	}
+
+	if (ofs < size) {
+		/* file was shorter than reported */
+		release_sdram_region(res);
+		res = request_sdram_region("image", adr, ofs);
+	}
+
+	return res;
+err:
+	release_sdram_region(res);
+
+	return NULL;
+}
+
+struct resource *file_to_sdram(const char *filename, unsigned long adr)
+{
+	struct resource *res;
+	struct stat s;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (!fstat(fd, &s) && s.st_size != FILE_SIZE_STREAM && s.st_size > 0 &&
+	    s.st_size <= SIZE_MAX)
+		res = file_to_sdram_sized(fd, adr, s.st_size);
+	else
+		res = file_to_sdram_stream(fd, adr);
+
 	close(fd);
 
 	return res;
@@ -158,6 +158,7 @@ static int xy_gets(struct console_device *cdev, struct kfifo *fifo,
 
 static void xy_putc(struct console_device *cdev, unsigned char c)
 {
+	console_tx_flush(cdev);
 	cdev->putc(cdev, c);
 }
 
@@ -12,6 +12,7 @@
 #include <asm/sections.h>
 #include <pbl.h>
 #include <debug_ll.h>
+#include <linux/sizes.h>
 
 #define STATIC static
 
@@ -31,15 +32,28 @@
 #include "../../../lib/decompress_unxz.c"
 #endif
 
+#ifdef CONFIG_IMAGE_COMPRESSION_ZSTD
+#include "../../../lib/decompress_unzstd.c"
+#endif
+
 #ifdef CONFIG_IMAGE_COMPRESSION_NONE
 STATIC int decompress(u8 *input, int in_len,
-				int (*fill) (void *, unsigned int),
-				int (*flush) (void *, unsigned int),
+				long (*fill) (void *, unsigned long),
+				long (*flush) (void *, unsigned long),
 				u8 *output, int *posp,
 				void (*error) (char *x))
 {
-	memcpy(output, input, in_len);
-	return 0;
+	long now;
+
+	if (!fill) {
+		memcpy(output, input, in_len);
+		return 0;
+	}
+
+	while ((now = fill(output, SZ_64K)) > 0)
+		output += now;
+
+	return now;
 }
 #endif
 
@@ -54,40 +68,110 @@ static void noinline errorfn(char *error)
 extern unsigned char sha_sum[];
 extern unsigned char sha_sum_end[];
 
+static void pbl_sha256_update(struct digest *d, const void *data,
+			      unsigned long len)
+{
+	if (sha256_ce_pbl_update(d, data, len))
+		sha256_update(d, data, len);
+}
+
+static void pbl_print_hashes(const char *computed_hash, const char *hash)
+{
+	int i;
+
+	puts_ll("CH ");
+
+	for (i = 0; i < SHA256_DIGEST_SIZE; i++)
+		puthexc_ll(computed_hash[i]);
+
+	puts_ll("\nIH ");
+
+	for (i = 0; i < SHA256_DIGEST_SIZE; i++)
+		puthexc_ll(hash[i]);
+
+	putc_ll('\n');
+}
+
 int pbl_barebox_verify(const void *compressed_start, unsigned int len,
 		       const void *hash, unsigned int hash_len)
 {
-	struct sha256_state sha_state = { 0 };
+	struct pbl_sha256_state sha_state = { 0 };
 	struct digest d = { .ctx = &sha_state };
 	char computed_hash[SHA256_DIGEST_SIZE];
-	int i;
-	const char *char_hash = hash;
 
 	if (hash_len != SHA256_DIGEST_SIZE)
 		return -1;
 
 	sha256_init(&d);
-	sha256_update(&d, compressed_start, len);
+	pbl_sha256_update(&d, compressed_start, len);
 	sha256_final(&d, computed_hash);
 	if (IS_ENABLED(CONFIG_DEBUG_LL)) {
-		puts_ll("CH ");
+		pbl_print_hashes(computed_hash, hash);
 
-		for (i = 0; i < SHA256_DIGEST_SIZE; i++)
-			puthexc_ll(computed_hash[i]);
+		pr_debug("Hexdump of first 64 bytes of %u\n", len);
+		print_hex_dump_bytes("", DUMP_PREFIX_ADDRESS, compressed_start, 64);
+	}
 
-		puts_ll("\nIH ");
+	return memcmp(hash, computed_hash, SHA256_DIGEST_SIZE);
+}
 
-		for (i = 0; i < SHA256_DIGEST_SIZE; i++)
-			puthexc_ll(char_hash[i]);
+#ifdef CONFIG_PBL_VERIFY_PIGGY_STREAMING
+static struct {
+	struct digest d;
+	struct pbl_sha256_state state;
+	const u8 *pos, *end;
+} pbl_stream;
 
-		putc_ll('\n');
+/*
+ * Feed the decompressor in small blocks and hash each block while it is
+ * still in the cache.
+ */
+static long pbl_stream_fill(void *buf, unsigned long len)
+{
+	len = min_t(unsigned long, len, pbl_stream.end - pbl_stream.pos);
 
-		pr_debug("Hexdump of first 64 bytes of %u\n", len);
-		print_hex_dump_bytes("", DUMP_PREFIX_ADDRESS, compressed_start, 64);
-	}
+	memcpy(buf, pbl_stream.pos, len);
+	pbl_sha256_update(&pbl_stream.d, buf, len);
+	pbl_stream.pos += len;
+
+	return len;
+}
+
+static int pbl_barebox_uncompress_verify(void *dest, void *compressed_start,
+					 unsigned int len, const void *hash,
+					 unsigned int hash_len)
+{
+	char computed_hash[SHA256_DIGEST_SIZE];
+
+	if (hash_len != SHA256_DIGEST_SIZE)
+		return -1;
+
+	pbl_stream.d.ctx = &pbl_stream.state;
+	pbl_stream.pos = compressed_start;
+	pbl_stream.end = compressed_start + len;
+
+	sha256_init(&pbl_stream.d);
+
+	decompress(NULL, 0, pbl_stream_fill, NULL, dest, NULL, errorfn);
+
+	/* hash trailing data the decompressor did not consume */
+	pbl_sha256_update(&pbl_stream.d, pbl_stream.pos,
+			  pbl_stream.end - pbl_stream.pos);
+	sha256_final(&pbl_stream.d, computed_hash);
+
+	if (IS_ENABLED(CONFIG_DEBUG_LL))
+		pbl_print_hashes(computed_hash, hash);
 
 	return memcmp(hash, computed_hash, SHA256_DIGEST_SIZE);
 }
+#else
+static int pbl_barebox_uncompress_verify(void *dest, void *compressed_start,
+					 unsigned int len, const void *hash,
+					 unsigned int hash_len)
+{
+	return -ENOSYS;
+}
+#endif
 
 void pbl_barebox_uncompress(void *dest, void *compressed_start, unsigned int len)
 {
@@ -98,6 +182,17 @@ void pbl_barebox_uncompress(void *dest, void *compressed_start, unsigned int len
 		pbl_hash_start = sha_sum;
 		pbl_hash_end = sha_sum_end;
 		pbl_hash_len = pbl_hash_end - pbl_hash_start;
+
+		if (IS_ENABLED(CONFIG_PBL_VERIFY_PIGGY_STREAMING)) {
+			if (pbl_barebox_uncompress_verify(dest, compressed_start,
+							  len, pbl_hash_start,
+							  pbl_hash_len) != 0) {
+				putc_ll('!');
+				panic("hash mismatch, refusing to start barebox");
+			}
+			return;
+		}
+
 		if (pbl_barebox_verify(compressed_start, len, pbl_hash_start,
 				       pbl_hash_len) != 0) {
 			putc_ll('!');
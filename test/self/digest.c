@@ -6,6 +6,7 @@
 #include <bselftest.h>
 #include <clock.h>
 #include <digest.h>
+#include <crypto/sha.h>
 
 BSELFTEST_GLOBALS();
 
@@ -196,6 +197,62 @@ static void test_digests_sha35(const char *suffix)
 				   "60a5a68aa0017e3446433349b42592b74713d7787628a58e400b7f588b9bd69b"));
 }
 
+#define CHUNK_SIZE	1024
+#define NCHUNKS		DIV_ROUND_UP(sizeof(inc4097), CHUNK_SIZE)
+
+static void expect_chunks(const u8 *hashes, size_t first, size_t n, int expected)
+{
+	int ret;
+
+	total_tests++;
+
+	ret = digest_chunks_verify("sha256", inc4097, sizeof(inc4097),
+				   CHUNK_SIZE, hashes, first, n);
+	if (ret != expected) {
+		printf("%s: verifying chunks %zu-%zu returned %pe, but %pe expected\n",
+		       __func__, first, first + n - 1, ERR_PTR(ret), ERR_PTR(expected));
+		failed_tests++;
+	}
+}
+
+static void test_digest_chunks(void)
+{
+	u8 hashes[NCHUNKS * SHA256_DIGEST_SIZE];
+	struct digest *d;
+	size_t i;
+
+	if (!IS_ENABLED(CONFIG_HAVE_DIGEST_SHA256)) {
+		skipped_tests++;
+		return;
+	}
+
+	d = digest_alloc("sha256");
+	if (!d) {
+		failed_tests++;
+		return;
+	}
+
+	for (i = 0; i < NCHUNKS; i++) {
+		size_t ofs = i * CHUNK_SIZE;
+
+		digest_digest(d, inc4097 + ofs,
+			      min_t(size_t, CHUNK_SIZE, sizeof(inc4097) - ofs),
+			      hashes + i * SHA256_DIGEST_SIZE);
+	}
+
+	digest_free(d);
+
+	expect_chunks(hashes, 0, NCHUNKS, 0);
+	expect_chunks(hashes, NCHUNKS - 1, 1, 0);
+	expect_chunks(hashes, 0, NCHUNKS + 1, -EINVAL);
+
+	hashes[3 * SHA256_DIGEST_SIZE] ^= 1;
+
+	expect_chunks(hashes, 0, NCHUNKS, -EBADMSG);
+	expect_chunks(hashes, 3, 1, -EBADMSG);
+	expect_chunks(hashes, 0, 3, 0);
+}
+
 static void test_digests(void)
 {
 	int i;
@@ -215,5 +272,6 @@ static void test_digests(void)
 	test_digests_sha12("");
 	test_digests_sha35("");
 
+	test_digest_chunks();
 }
 bselftest(core, test_digests);
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <errno.h>
+#include <bselftest.h>
+#include <malloc.h>
+#include <memtest.h>
+#include <linux/sizes.h>
+
+BSELFTEST_GLOBALS();
+
+#define MEMTEST_SIZE	(SZ_1M + 3 * sizeof(resource_size_t) + 5)
+
+static void expect_ret(int ret, int expected, const char *what)
+{
+	total_tests++;
+
+	if (ret != expected) {
+		failed_tests++;
+		printf("%s returned %d, expected %d\n", what, ret, expected);
+	}
+}
+
+static void expect_zeroed(const u8 *buf, size_t size)
+{
+	size_t i;
+
+	total_tests++;
+
+	for (i = 0; i < size; i++) {
+		if (buf[i]) {
+			failed_tests++;
+			printf("moving inversions left 0x%02x at offset %zu\n",
+			       buf[i], i);
+			return;
+		}
+	}
+}
+
+static void test_memtest(void)
+{
+	resource_size_t start, end;
+	u8 *buf;
+
+	buf = malloc(MEMTEST_SIZE);
+	if (!buf) {
+		skipped_tests++;
+		return;
+	}
+
+	/* exercise the alignment fixup and a partial last block */
+	start = (resource_size_t)(unsigned long)buf + 1;
+	end = (resource_size_t)(unsigned long)buf + MEMTEST_SIZE - 1;
+
+	expect_ret(mem_test_bus_integrity(start, end, 0), 0,
+		   "mem_test_bus_integrity");
+
+	memset(buf, 0xa5, MEMTEST_SIZE);
+
+	expect_ret(mem_test_moving_inversions(start, end, 0), 0,
+		   "mem_test_moving_inversions");
+
+	/* every word covered by the test must be zeroed again */
+	start = ALIGN(start, sizeof(resource_size_t));
+	expect_zeroed((u8 *)(unsigned long)start,
+		      ALIGN_DOWN(end, sizeof(resource_size_t)) - start);
+
+	expect_ret(mem_test_moving_inversions(end, end, 0), -EINVAL,
+		   "mem_test_moving_inversions on empty range");
+
+	free(buf);
+}
+bselftest(core, test_memtest);
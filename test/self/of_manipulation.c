@@ -11,6 +11,7 @@
 #include <linux/string.h>
 #include <errno.h>
 #include <of.h>
+#include <fdt.h>
 
 BSELFTEST_GLOBALS();
 
@@ -110,6 +111,67 @@ static void test_of_property_strings(struct device_node *root)
 	assert_equal(np3, np4);
 }
 
+static unsigned int tree_fixup_calls;
+
+static int test_tree_fixup(struct device_node *root, void *context)
+{
+	tree_fixup_calls++;
+
+	return of_property_write_bool(root, "barebox,selftest-tree-fixup", true);
+}
+
+static void expect_tree_fixup_calls(unsigned int expected, const char *what)
+{
+	total_tests++;
+
+	if (tree_fixup_calls == expected)
+		return;
+
+	pr_warn("%s: tree fixup called %u times, expected %u\n", what,
+		tree_fixup_calls, expected);
+	failed_tests++;
+}
+
+static void test_of_fixup_cache(void)
+{
+	struct device_node *root = of_get_root_node(), *fixed;
+	struct fdt_header *fdt;
+
+	if (!IS_ENABLED(CONFIG_OF_FIXUP_CACHE) || !root) {
+		skipped_tests++;
+		return;
+	}
+
+	tree_fixup_calls = 0;
+	of_register_tree_fixup(test_tree_fixup, NULL);
+
+	free(of_get_fixed_tree(NULL));
+	free(of_get_fixed_tree(NULL));
+	expect_tree_fixup_calls(1, "unchanged live tree");
+
+	of_property_write_bool(root, "barebox,selftest-live", true);
+
+	fdt = of_get_fixed_tree(NULL);
+	expect_tree_fixup_calls(2, "modified live tree");
+
+	fixed = fdt ? of_unflatten_dtb(fdt, fdt32_to_cpu(fdt->totalsize)) : NULL;
+	free(fdt);
+
+	total_tests++;
+	if (IS_ERR_OR_NULL(fixed) ||
+	    !of_property_read_bool(fixed, "barebox,selftest-live") ||
+	    !of_property_read_bool(fixed, "barebox,selftest-tree-fixup")) {
+		pr_warn("fixed tree is missing properties\n");
+		failed_tests++;
+	}
+
+	if (!IS_ERR_OR_NULL(fixed))
+		of_delete_node(fixed);
+
+	of_property_write_bool(root, "barebox,selftest-live", false);
+	of_unregister_fixup(test_tree_fixup, NULL);
+}
+
 static void __init test_of_manipulation(void)
 {
 	extern char __dtb_of_manipulation_start[], __dtb_of_manipulation_end[];
@@ -128,5 +190,7 @@ static void __init test_of_manipulation(void)
 
 	of_delete_node(root);
 	of_delete_node(expected);
+
+	test_of_fixup_cache();
 }
 bselftest(core, test_of_manipulation);
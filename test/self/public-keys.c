@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <common.h>
+#include <bselftest.h>
+#include <digest.h>
+#include <malloc.h>
+#include <crypto/public_key.h>
+#include <crypto/rsa.h>
+
+BSELFTEST_GLOBALS();
+
+/* more keys than hash buckets, so some of them have to share a bucket */
+#define NUM_KEYS	40
+#define MODULUS_WORDS	8
+
+struct test_key {
+	struct public_key key;
+	struct rsa_public_key rsa;
+	uint32_t modulus[MODULUS_WORDS];
+	u8 fp[SHA256_DIGEST_SIZE];
+};
+
+static struct test_key *test_key_alloc(const char *name, uint32_t seed)
+{
+	struct test_key *t = xzalloc(sizeof(*t));
+	int i;
+
+	for (i = 0; i < MODULUS_WORDS; i++)
+		t->modulus[i] = seed * 0x9e3779b9 + i;
+
+	t->rsa.len = MODULUS_WORDS;
+	t->rsa.modulus = t->modulus;
+	t->key.type = PUBLIC_KEY_TYPE_RSA;
+	t->key.rsa = &t->rsa;
+	t->key.key_name_hint = basprintf("selftest-%s-%u", name, seed);
+
+	return t;
+}
+
+static void test_key_free(struct test_key *t)
+{
+	free(t->key.key_name_hint);
+	free(t);
+}
+
+/* the fingerprint is SHA-256 over the big endian modulus */
+static int test_key_fingerprint(struct test_key *t)
+{
+	struct digest *d;
+	int i, ret;
+
+	d = digest_alloc_by_algo(HASH_ALGO_SHA256);
+	if (!d)
+		return -ENOSYS;
+
+	ret = digest_init(d);
+	for (i = MODULUS_WORDS - 1; !ret && i >= 0; i--) {
+		__be32 w = cpu_to_be32(t->modulus[i]);
+
+		ret = digest_update(d, &w, sizeof(w));
+	}
+	if (!ret)
+		ret = digest_final(d, t->fp);
+
+	digest_free(d);
+
+	return ret;
+}
+
+static void expect_lookup(const void *fp, size_t len,
+			  const struct public_key *expected, const char *what)
+{
+	const struct public_key *key;
+
+	total_tests++;
+
+	key = public_key_get_by_fingerprint(fp, len);
+	if (key != expected) {
+		failed_tests++;
+		printf("%s: found %s, expected %s\n", what,
+		       key ? key->key_name_hint : "no key",
+		       expected ? expected->key_name_hint : "no key");
+	}
+}
+
+static void test_public_keys(void)
+{
+	struct test_key *keys[NUM_KEYS], *nofp, *dup;
+	u8 fp[SHA256_DIGEST_SIZE];
+	int i, ret;
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		keys[i] = test_key_alloc("key", i);
+
+		ret = test_key_fingerprint(keys[i]);
+		if (ret) {
+			test_key_free(keys[i]);
+			while (i--)
+				test_key_free(keys[i]);
+			pr_info("no SHA-256 digest: %pe\n", ERR_PTR(ret));
+			skipped_tests++;
+			return;
+		}
+	}
+
+	/* a key of unknown type has no fingerprint and must not be found */
+	nofp = test_key_alloc("nofp", 0);
+	nofp->key.type = (enum public_key_type)-1;
+
+	/* a second key with the same material as keys[0] */
+	dup = test_key_alloc("dup", 0);
+	test_key_fingerprint(dup);
+
+	total_tests++;
+	ret = public_key_add(&nofp->key);
+	if (ret) {
+		failed_tests++;
+		printf("adding key without fingerprint failed: %pe\n",
+		       ERR_PTR(ret));
+	}
+
+	for (i = 0; i < NUM_KEYS; i++)
+		public_key_add(&keys[i]->key);
+
+	public_key_add(&dup->key);
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		total_tests++;
+		if (memcmp(keys[i]->key.fingerprint, keys[i]->fp,
+			   SHA256_DIGEST_SIZE)) {
+			failed_tests++;
+			printf("%s: wrong fingerprint\n",
+			       keys[i]->key.key_name_hint);
+		}
+
+		expect_lookup(keys[i]->fp, SHA256_DIGEST_SIZE, &keys[i]->key,
+			      "lookup");
+	}
+
+	expect_lookup(keys[0]->fp, SHA256_DIGEST_SIZE - 1, NULL,
+		      "lookup with short fingerprint");
+
+	memcpy(fp, keys[1]->fp, sizeof(fp));
+	fp[sizeof(fp) - 1] ^= 1;
+	expect_lookup(fp, sizeof(fp), NULL, "lookup of unknown fingerprint");
+
+	memset(fp, 0, sizeof(fp));
+	expect_lookup(fp, sizeof(fp), NULL, "lookup of all zero fingerprint");
+
+	total_tests++;
+	if (public_key_get(nofp->key.key_name_hint) != &nofp->key) {
+		failed_tests++;
+		printf("key without fingerprint not found by name\n");
+	}
+
+	/* once keys[0] is gone, the key with the same material takes over */
+	public_key_del(&keys[0]->key);
+	expect_lookup(keys[0]->fp, SHA256_DIGEST_SIZE, &dup->key,
+		      "lookup after removing a key");
+
+	public_key_del(&dup->key);
+	expect_lookup(keys[0]->fp, SHA256_DIGEST_SIZE, NULL,
+		      "lookup after removing all keys");
+
+	for (i = 1; i < NUM_KEYS; i++)
+		public_key_del(&keys[i]->key);
+	public_key_del(&nofp->key);
+
+	for (i = 0; i < NUM_KEYS; i++)
+		test_key_free(keys[i]);
+	test_key_free(nofp);
+	test_key_free(dup);
+}
+bselftest(core, test_public_keys);
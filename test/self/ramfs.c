@@ -89,7 +89,7 @@ static void test_tree(const char *path, struct test_tree_ctx *ctx)
 	popd(oldwd);
 }
 
-static void test_ramfs(void)
+static void test_ramfs_tree(void)
 {
 	int files[] = { 1, 3, 5, 7, 11, 13, 17 };
 	char fname[128];
@@ -261,4 +261,62 @@ static void test_ramfs(void)
 	expect_fail(dir ? 0 : -EISDIR, "opening removed directory");
 	free(dname);
 }
+
+static void test_ramfs_memmap(void)
+{
+	const size_t chunk = 1000, nchunks = 300;
+	char *fname, *buf;
+	const u8 *map;
+	int fd, ret, i, j;
+
+	fname = make_temp("ramfs-memmap");
+
+	fd = open(fname, O_RDWR | O_CREAT);
+	if (!expect_success(fd, "creating file"))
+		goto out;
+
+	/*
+	 * Files written in small pieces end up in multiple chunks, which
+	 * can't be mapped. Truncating to the final size up front allocates
+	 * a single chunk.
+	 */
+	ret = ftruncate(fd, nchunks * chunk);
+	if (!expect_success(ret, "truncating file"))
+		goto out_close;
+
+	buf = xmalloc(chunk);
+
+	for (i = 0; i < nchunks; i++) {
+		memset(buf, i, chunk);
+		ret = write(fd, buf, chunk);
+		expect_success(ret, "writing file");
+	}
+
+	free(buf);
+
+	map = memmap(fd, PROT_READ);
+	if (expect_success(map == MAP_FAILED ? -errno : 0, "memmap()")) {
+		for (i = 0; i < nchunks; i++) {
+			for (j = 0; j < chunk; j++) {
+				if (map[i * chunk + j] != (u8)i)
+					break;
+			}
+			if (!expect_success(j == chunk ? 0 : -EINVAL,
+					    "memmap content at chunk %d", i))
+				break;
+		}
+	}
+
+out_close:
+	close(fd);
+	unlink(fname);
+out:
+	free(fname);
+}
+
+static void test_ramfs(void)
+{
+	test_ramfs_tree();
+	test_ramfs_memmap();
+}
 bselftest(core, test_ramfs);